@@ -0,0 +1,326 @@
+// ---------------------------------------------------------------------------
+// Audio Resampler Class
+//
+// Polyphase windowed-sinc resampler for interleaved float audio
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <windows.h>
+
+#include "AudioUtils.h"
+#include "AudioResampler.h"
+
+#if FPVR_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace FPVR
+{
+	// Filter design for each quality level
+	typedef struct
+	{
+		int		mTaps;		// Taps per phase (multiple of 8)
+		int		mPhases;	// Phases in table
+		double	mBeta;		// Kaiser window beta (stop band attenuation)
+		double	mRolloff;	// Pass band as fraction of Nyquist
+	} sResampleQuality;
+
+	static const sResampleQuality gResampleQuality[ResampleQualityCount] =
+	{
+		{  8,  32, 5.0, 0.85 },		// ResampleFast
+		{ 16,  64, 6.5, 0.90 },		// ResampleMedium
+		{ 32, 128, 8.0, 0.94 },		// ResampleHigh
+		{ 64, 256, 9.5, 0.96 },		// ResampleBest
+	};
+
+	static const double kPi = 3.14159265358979323846;
+
+	// Zeroth order modified Bessel function of the first kind (for Kaiser window)
+	static double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// Dot product of n floats (n is a multiple of 8)
+	static inline float Dot(const float* a, const float* b, int n)
+	{
+#if FPVR_HAVE_SSE2
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		for (int i = 0; i < n; i += 8)
+		{
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		acc0 = _mm_add_ps(acc0, acc1);
+		acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+		acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(acc0);
+#else
+		float sum = 0.0f;
+		for (int i = 0; i < n; i++)
+		{
+			sum += a[i] * b[i];
+		}
+		return sum;
+#endif
+	}
+
+	// Set up for the specified conversion and clear history (no allocation)
+	void AudioResampler::Configure(int channels, int inRate, int outRate, eResampleQuality quality, bool variableRatio)
+	{
+		assert(channels > 0 && channels <= MaxChannels && inRate > 0 && outRate > 0);
+
+		if (quality < ResampleFast || quality >= ResampleQualityCount)
+		{
+			quality = ResampleHigh;
+		}
+		const sResampleQuality& q = gResampleQuality[quality];
+
+		mChannels = channels;
+		mInRate = inRate;
+		mOutRate = outRate;
+		mTaps = q.mTaps;
+		mPhases = q.mPhases;
+		mBypass = (inRate == outRate && !variableRatio);
+		mBaseStep = (double)inRate / (double)outRate;
+		mStep = mBaseStep;
+
+		// When downsampling the cutoff has to move down to the output Nyquist frequency
+		double cutoff = 0.5 * q.mRolloff * (outRate < inRate ? (double)outRate / (double)inRate : 1.0);
+		BuildTable(cutoff, q.mBeta);
+		Reset();
+	}
+
+	// Build filter table for the current configuration. Phase p holds the filter for an output
+	// frame p / mPhases of an input frame beyond the tap base, each phase is normalised for unity
+	// gain at DC.
+	void AudioResampler::BuildTable(double cutoff, double beta)
+	{
+		const int half = mTaps / 2;
+		const double i0Beta = BesselI0(beta);
+
+		for (int p = 0; p <= mPhases; p++)
+		{
+			float* coefs = mTable + p * mTaps;
+			double frac = (double)p / (double)mPhases;
+			double sum = 0.0;
+			for (int k = 0; k < mTaps; k++)
+			{
+				double t = (double)(k - (half - 1)) - frac;
+				double x = t / (double)half;
+				double window = BesselI0(beta * sqrt(x * x < 1.0 ? 1.0 - x * x : 0.0)) / i0Beta;
+				double sinc = (t == 0.0 ? 2.0 * cutoff : sin(2.0 * kPi * cutoff * t) / (kPi * t));
+				coefs[k] = (float)(sinc * window);
+				sum += coefs[k];
+			}
+			for (int k = 0; k < mTaps; k++)
+			{
+				coefs[k] = (float)(coefs[k] / sum);
+			}
+		}
+	}
+
+	// Clear history. History is primed with silence so the first output frame is centred on
+	// the first input frame.
+	void AudioResampler::Reset()
+	{
+		mBuffered = mTaps / 2 - 1;
+		mPos = 0.0;
+		for (int c = 0; c < MaxChannels; c++)
+		{
+			memset(mHistory + c * HistoryFrames, 0, mBuffered * sizeof(float));
+		}
+	}
+
+	// Accept input frames into history then produce as many output frames as history allows
+	int AudioResampler::Process(const float* in, int inFrames, float* out, int maxOutFrames, int* inUsed)
+	{
+		if (mBypass)
+		{
+			int frames = (inFrames < maxOutFrames ? inFrames : maxOutFrames);
+			memcpy(out, in, frames * mChannels * sizeof(float));
+			*inUsed = frames;
+			return frames;
+		}
+
+		// Append input to planar history
+		int accept = HistoryFrames - mBuffered;
+		if (accept > inFrames)
+		{
+			accept = inFrames;
+		}
+		float* planes[MaxChannels];
+		for (int c = 0; c < mChannels; c++)
+		{
+			planes[c] = mHistory + c * HistoryFrames + mBuffered;
+		}
+		Deinterleave(in, mChannels, accept, planes);
+		mBuffered += accept;
+		*inUsed = accept;
+
+		// Produce output while the filter has a full set of taps
+		int produced = 0;
+		while (produced < maxOutFrames)
+		{
+			int ipos = (int)mPos;
+			if (ipos + mTaps > mBuffered)
+			{
+				break;
+			}
+
+			// Interpolate coefficients between the two nearest table phases
+			double fphase = (mPos - ipos) * mPhases;
+			int phase = (int)fphase;
+			float t = (float)(fphase - phase);
+			const float* c0 = mTable + phase * mTaps;
+			const float* c1 = c0 + mTaps;
+#if FPVR_HAVE_SSE2
+			__m128 vt = _mm_set1_ps(t);
+			for (int k = 0; k < mTaps; k += 4)
+			{
+				__m128 a = _mm_loadu_ps(c0 + k);
+				__m128 b = _mm_loadu_ps(c1 + k);
+				_mm_storeu_ps(mCoefs + k, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), vt)));
+			}
+#else
+			for (int k = 0; k < mTaps; k++)
+			{
+				mCoefs[k] = c0[k] + (c1[k] - c0[k]) * t;
+			}
+#endif
+
+			float* dst = out + produced * mChannels;
+			for (int c = 0; c < mChannels; c++)
+			{
+				dst[c] = Dot(mHistory + c * HistoryFrames + ipos, mCoefs, mTaps);
+			}
+
+			produced++;
+			mPos += mStep;
+		}
+
+		// Discard history no longer needed by the filter
+		int drop = (int)mPos;
+		if (drop > mBuffered)
+		{
+			drop = mBuffered;
+		}
+		if (drop > 0)
+		{
+			for (int c = 0; c < mChannels; c++)
+			{
+				float* h = mHistory + c * HistoryFrames;
+				memmove(h, h + drop, (mBuffered - drop) * sizeof(float));
+			}
+			mBuffered -= drop;
+			mPos -= drop;
+		}
+
+		return produced;
+	}
+
+	// CPU time used by the calling thread (microseconds)
+	static double ThreadCPUMicroseconds()
+	{
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		{
+			return 0.0;
+		}
+		uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+		uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+		return (double)(k + u) * 0.1;
+	}
+
+	// Measure the cost of converting inRate to outRate at the specified quality. Converts
+	// several seconds of noise and returns microseconds of the calling thread's CPU time per
+	// channel-second of output, so time the thread spends preempted isn't counted.
+	double AudioResampler::Benchmark(eResampleQuality quality, int channels, int inRate, int outRate)
+	{
+		static const int kSeconds = 4;
+
+		AudioResampler* rs = Create();
+		rs->Configure(channels, inRate, outRate, quality);
+
+		std::vector<float> in(BlockFrames * channels);
+		std::vector<float> out(BlockFrames * 4 * channels);
+		unsigned int seed = 12345;
+		for (size_t i = 0; i < in.size(); i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			in[i] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+		}
+
+		int64_t outFrames = 0;
+		double start = ThreadCPUMicroseconds();
+		for (int64_t inFrames = 0; inFrames < (int64_t)inRate * kSeconds; inFrames += BlockFrames)
+		{
+			const float* src = in.data();
+			int remaining = BlockFrames;
+			while (remaining > 0)
+			{
+				int used;
+				outFrames += rs->Process(src, remaining, out.data(), BlockFrames * 4, &used);
+				src += used * channels;
+				remaining -= used;
+			}
+		}
+		double elapsedUs = ThreadCPUMicroseconds() - start;
+		rs->Release();
+
+		double channelSeconds = (double)outFrames / (double)outRate * channels;
+		return (channelSeconds > 0.0 ? elapsedUs / channelSeconds : 0.0);
+	}
+
+	// Create a resampler with storage for up to MaxChannels
+	AudioResampler* AudioResampler::Create()
+	{
+		AudioResampler* rs = new AudioResampler();
+		rs->Configure(1, 48000, 48000, ResampleHigh);
+		return rs;
+	}
+
+	// Release the resampler
+	void AudioResampler::Release()
+	{
+		delete this;
+	}
+
+	// Constructor: allocate storage for the largest configuration
+	AudioResampler::AudioResampler()
+	{
+		mTable = new float[(MaxPhases + 1) * MaxTaps];
+		mHistory = new float[MaxChannels * HistoryFrames];
+		mCoefs = new float[MaxTaps];
+
+		mChannels = 0;
+		mInRate = 0;
+		mOutRate = 0;
+		mTaps = 0;
+		mPhases = 0;
+		mBypass = true;
+		mBaseStep = 1.0;
+		mStep = 1.0;
+		mPos = 0.0;
+		mBuffered = 0;
+	}
+
+	// Destructor: free storage
+	AudioResampler::~AudioResampler()
+	{
+		delete[] mTable;
+		delete[] mHistory;
+		delete[] mCoefs;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Audio Resampler Class
+//
+// Polyphase windowed-sinc resampler for interleaved float audio. Filters are
+// Kaiser windowed sinc with a table of phases, coefficients for positions
+// between table phases are linearly interpolated so any ratio (including the
+// small adjustments used for drift correction) can be used.
+//
+// All storage is allocated when the resampler is created (sized for the
+// highest quality and MaxChannels) so reconfiguring never allocates.
+
+namespace FPVR
+{
+	// Resampler quality levels (taps per output sample / table phases)
+	typedef enum
+	{
+		ResampleFast = 0,			// 8 taps, 32 phases
+		ResampleMedium = 1,			// 16 taps, 64 phases
+		ResampleHigh = 2,			// 32 taps, 128 phases
+		ResampleBest = 3,			// 64 taps, 256 phases
+		ResampleQualityCount = 4
+	} eResampleQuality;
+
+	class AudioResampler
+	{
+	public:
+		static const int MaxChannels = 8;
+		static const int MaxTaps = 64;
+		static const int MaxPhases = 256;
+		static const int BlockFrames = 1024;	// Maximum input frames buffered per Process call
+
+		// Create a resampler with storage for up to MaxChannels
+		static AudioResampler* Create();
+
+		// Release the resampler
+		void Release();
+
+		// Set up for the specified conversion and clear history (no allocation). If variableRatio
+		// is true the filter is used even when rates match so SetRatioAdjust can be applied.
+		void Configure(int channels, int inRate, int outRate, eResampleQuality quality, bool variableRatio = false);
+
+		// Scale the conversion ratio by adjust (eg. 1.002 consumes 0.2% more input per output
+		// frame). Only effective if configured with variableRatio.
+		void SetRatioAdjust(double adjust) { mStep = mBaseStep * adjust; }
+
+		// Clear history (eg. after a flush)
+		void Reset();
+
+		// Accept up to inFrames interleaved frames and produce up to maxOutFrames interleaved
+		// frames. Returns number of frames produced, inUsed is set to the frames accepted.
+		// Call repeatedly until all input has been accepted.
+		int Process(const float* in, int inFrames, float* out, int maxOutFrames, int* inUsed);
+
+		// True if no conversion is being performed
+		bool IsBypassed() const { return mBypass; }
+
+		int Channels() const { return mChannels; }
+		int InRate() const { return mInRate; }
+		int OutRate() const { return mOutRate; }
+
+		// Measure the cost of converting inRate to outRate at the specified quality.
+		// Returns microseconds of CPU time per channel-second of output.
+		static double Benchmark(eResampleQuality quality, int channels, int inRate, int outRate);
+
+	protected:
+		int mChannels;				// Interleaved channels
+		int mInRate;				// Input sample rate in Hz
+		int mOutRate;				// Output sample rate in Hz
+		int mTaps;					// Taps per filter phase (multiple of 4)
+		int mPhases;				// Phases in filter table (table holds mPhases + 1)
+		bool mBypass;				// True if rates match (samples are copied)
+
+		double mBaseStep;			// Input frames per output frame for configured rates
+		double mStep;				// Input frames advanced per output frame (including adjustment)
+		double mPos;				// Position of next output frame in history (in input frames)
+
+		float* mTable;				// Filter table: (mPhases + 1) * mTaps coefficients
+		float* mHistory;			// Planar history: MaxChannels * HistoryFrames samples
+		int mBuffered;				// Frames of history currently buffered
+
+		float* mCoefs;				// Interpolated coefficients for current output frame (MaxTaps)
+
+		static const int HistoryFrames = MaxTaps + BlockFrames;
+
+		// Build filter table for the current configuration
+		void BuildTable(double cutoff, double beta);
+
+		AudioResampler();
+		~AudioResampler();
+	};
+}
@@ -0,0 +1,135 @@
+// ---------------------------------------------------------------------------
+// Audio Ring Buffer Class
+//
+// Single producer / single consumer lock-free ring of float samples
+
+#include <cassert>
+#include <cstring>
+
+#include "AudioRingBuffer.h"
+
+namespace FPVR
+{
+	// Producer: append up to count samples, returns number written (excess is dropped)
+	int AudioRingBuffer::Write(const float* samples, int count, int granularity)
+	{
+		uint32_t writePos = mWritePos.load(std::memory_order_relaxed);
+		uint32_t readPos = mReadPos.load(std::memory_order_acquire);
+		uint32_t space = (mMask + 1) - (writePos - readPos);
+
+		uint32_t toWrite = ((uint32_t)count < space ? (uint32_t)count : space);
+		toWrite -= toWrite % (uint32_t)granularity;
+		if (toWrite < (uint32_t)count)
+		{
+			mDroppedSamples.fetch_add(count - toWrite, std::memory_order_relaxed);
+		}
+
+		// Copy in at most two parts as the write may wrap around the end of the buffer
+		uint32_t offset = writePos & mMask;
+		uint32_t first = (toWrite < (mMask + 1) - offset ? toWrite : (mMask + 1) - offset);
+		memcpy(mBuffer + offset, samples, first * sizeof(float));
+		memcpy(mBuffer, samples + first, (toWrite - first) * sizeof(float));
+
+		mWritePos.store(writePos + toWrite, std::memory_order_release);
+		return (int)toWrite;
+	}
+
+	// Producer: discard all samples written so far
+	void AudioRingBuffer::RequestFlush()
+	{
+		mFlushPos.store(mWritePos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		mFlushPending.store(true, std::memory_order_release);
+	}
+
+	// Consumer: apply any pending flush request. Several flushes may be merged into one
+	// and the read position only ever moves forward.
+	void AudioRingBuffer::ApplyFlush()
+	{
+		if (mFlushPending.exchange(false, std::memory_order_acquire))
+		{
+			uint32_t flushPos = mFlushPos.load(std::memory_order_relaxed);
+			uint32_t readPos = mReadPos.load(std::memory_order_relaxed);
+			if ((int32_t)(flushPos - readPos) > 0)
+			{
+				mReadPos.store(flushPos, std::memory_order_release);
+			}
+		}
+	}
+
+	// Consumer: copy up to maxCount samples to buffer, returns number copied
+	int AudioRingBuffer::Read(float* buffer, int maxCount, int granularity)
+	{
+		ApplyFlush();
+
+		uint32_t readPos = mReadPos.load(std::memory_order_relaxed);
+		uint32_t writePos = mWritePos.load(std::memory_order_acquire);
+		uint32_t available = writePos - readPos;
+
+		uint32_t toRead = ((uint32_t)maxCount < available ? (uint32_t)maxCount : available);
+		toRead -= toRead % (uint32_t)granularity;
+
+		uint32_t offset = readPos & mMask;
+		uint32_t first = (toRead < (mMask + 1) - offset ? toRead : (mMask + 1) - offset);
+		memcpy(buffer, mBuffer + offset, first * sizeof(float));
+		memcpy(buffer + first, mBuffer, (toRead - first) * sizeof(float));
+
+		mReadPos.store(readPos + toRead, std::memory_order_release);
+		return (int)toRead;
+	}
+
+	// Consumer: number of samples available to read
+	int AudioRingBuffer::Available()
+	{
+		ApplyFlush();
+		return Fill();
+	}
+
+	// Empty the ring (neither producer nor consumer may be active)
+	void AudioRingBuffer::Reset()
+	{
+		mWritePos.store(0, std::memory_order_relaxed);
+		mReadPos.store(0, std::memory_order_relaxed);
+		mFlushPos.store(0, std::memory_order_relaxed);
+		mFlushPending.store(false, std::memory_order_relaxed);
+		mDroppedSamples.store(0, std::memory_order_relaxed);
+	}
+
+	// Create a ring able to hold at least capacity samples (rounded up to a power of two)
+	AudioRingBuffer* AudioRingBuffer::Create(int capacity)
+	{
+		assert(capacity > 0 && capacity <= (1 << 30));
+		AudioRingBuffer* ring = new AudioRingBuffer(capacity);
+		if (ring->mBuffer == nullptr)
+		{
+			delete ring;
+			return nullptr;
+		}
+		return ring;
+	}
+
+	// Release the ring (neither producer nor consumer may be active)
+	void AudioRingBuffer::Release()
+	{
+		delete this;
+	}
+
+	// Constructor: allocate sample storage
+	AudioRingBuffer::AudioRingBuffer(int capacity)
+	{
+		uint32_t size = 1;
+		while (size < (uint32_t)capacity)
+		{
+			size <<= 1;
+		}
+		mBuffer = new float[size];
+		mMask = size - 1;
+		memset(mBuffer, 0, size * sizeof(float));
+		Reset();
+	}
+
+	// Destructor: free sample storage
+	AudioRingBuffer::~AudioRingBuffer()
+	{
+		delete[] mBuffer;
+	}
+}
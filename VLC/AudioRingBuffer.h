@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Audio Ring Buffer Class
+//
+// Single producer / single consumer lock-free ring of float samples. The
+// producer is libvlc's audio output thread (play/flush callbacks), the
+// consumer is Unity's audio thread (RetrieveAudioData). Storage is allocated
+// once when the ring is created so neither side ever allocates.
+//
+// Flush is requested by the producer but performed by the consumer (which
+// owns the read position) the next time it reads.
+
+namespace FPVR
+{
+	class AudioRingBuffer
+	{
+	public:
+		// Create a ring able to hold at least capacity samples (rounded up to a power of two)
+		static AudioRingBuffer* Create(int capacity);
+
+		// Release the ring (neither producer nor consumer may be active)
+		void Release();
+
+		// Number of samples the ring can hold
+		int Capacity() const { return (int)(mMask + 1); }
+
+		// Producer: append up to count samples, returns number written (excess is dropped). Only
+		// whole multiples of granularity are written so interleaved frames are never split.
+		int Write(const float* samples, int count, int granularity = 1);
+
+		// Producer: discard all samples written so far
+		void RequestFlush();
+
+		// Consumer: copy up to maxCount samples to buffer, returns number copied (a multiple of granularity)
+		int Read(float* buffer, int maxCount, int granularity = 1);
+
+		// Consumer: number of samples available to read
+		int Available();
+
+		// Producer or consumer: approximate number of samples in the ring
+		int Fill() const { return (int)(mWritePos.load(std::memory_order_acquire) - mReadPos.load(std::memory_order_acquire)); }
+
+		// Number of samples dropped because the ring was full
+		uint64_t DroppedSamples() const { return mDroppedSamples.load(std::memory_order_relaxed); }
+
+		// Empty the ring (neither producer nor consumer may be active)
+		void Reset();
+
+	protected:
+		float* mBuffer;									// Sample storage (mMask + 1 samples)
+		uint32_t mMask;									// Capacity - 1
+
+		char mPad0[64];									// Keeps positions on separate cache lines
+		std::atomic<uint32_t> mWritePos;				// Total samples written (owned by producer)
+		char mPad1[60];
+		std::atomic<uint32_t> mReadPos;					// Total samples read (owned by consumer)
+		char mPad2[60];
+
+		std::atomic<uint32_t> mFlushPos;				// Write position at the last flush request
+		std::atomic<bool> mFlushPending;				// True if consumer has to apply mFlushPos
+		std::atomic<uint64_t> mDroppedSamples;			// Samples dropped because the ring was full
+
+		// Consumer: apply any pending flush request
+		void ApplyFlush();
+
+		AudioRingBuffer(int capacity);
+		~AudioRingBuffer();
+	};
+}
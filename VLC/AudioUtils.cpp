@@ -0,0 +1,85 @@
+// --------------------------------------------------------------------------
+// Audio helper utilities
+
+#include "AudioUtils.h"
+
+#if FPVR_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace FPVR
+{
+	// Split interleaved samples into planar buffers. Four frames are processed at a time,
+	// channels in groups of four are transposed as 4x4 blocks, a remaining pair is split
+	// with shuffles and any remaining single channel is gathered.
+	void Deinterleave(const float* src, int srcChannels, int frames, float* const* dst)
+	{
+		const int C = srcChannels;
+		int f = 0;
+
+#if FPVR_HAVE_SSE2
+		for (; f + 4 <= frames; f += 4)
+		{
+			const float* s0 = src + (f + 0) * C;
+			const float* s1 = src + (f + 1) * C;
+			const float* s2 = src + (f + 2) * C;
+			const float* s3 = src + (f + 3) * C;
+			int c = 0;
+
+			for (; c + 4 <= C; c += 4)
+			{
+				__m128 r0 = _mm_loadu_ps(s0 + c);
+				__m128 r1 = _mm_loadu_ps(s1 + c);
+				__m128 r2 = _mm_loadu_ps(s2 + c);
+				__m128 r3 = _mm_loadu_ps(s3 + c);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_ps(dst[c + 0] + f, r0);
+				_mm_storeu_ps(dst[c + 1] + f, r1);
+				_mm_storeu_ps(dst[c + 2] + f, r2);
+				_mm_storeu_ps(dst[c + 3] + f, r3);
+			}
+			for (; c + 2 <= C; c += 2)
+			{
+				__m128 a = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(s0 + c)), (const __m64*)(s1 + c));
+				__m128 b = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(s2 + c)), (const __m64*)(s3 + c));
+				_mm_storeu_ps(dst[c + 0] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+				_mm_storeu_ps(dst[c + 1] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+			}
+			for (; c < C; c++)
+			{
+				_mm_storeu_ps(dst[c] + f, _mm_setr_ps(s0[c], s1[c], s2[c], s3[c]));
+			}
+		}
+#endif
+
+		// Remaining frames (or all frames without SSE)
+		for (; f < frames; f++)
+		{
+			const float* s = src + f * C;
+			for (int c = 0; c < C; c++)
+			{
+				dst[c][f] = s[c];
+			}
+		}
+	}
+
+	// Multiply count samples by gain in place, four at a time
+	void ScaleSamples(float* samples, int count, float gain)
+	{
+		int i = 0;
+
+#if FPVR_HAVE_SSE2
+		const __m128 vGain = _mm_set1_ps(gain);
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), vGain));
+		}
+#endif
+
+		// Remaining samples (or all samples without SSE)
+		for (; i < count; i++)
+		{
+			samples[i] *= gain;
+		}
+	}
+}
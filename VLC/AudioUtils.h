@@ -0,0 +1,19 @@
+#pragma once
+
+// --------------------------------------------------------------------------
+// Audio helper utilities
+
+// SSE2 is always available on the x86/x64 targets we build for
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FPVR_HAVE_SSE2 1
+#endif
+
+namespace FPVR
+{
+	// Split interleaved samples into planar buffers. src holds frames * srcChannels samples,
+	// dst[c] receives frames samples for channel c (0 <= c < srcChannels).
+	extern void Deinterleave(const float* src, int srcChannels, int frames, float* const* dst);
+
+	// Multiply count samples by gain in place
+	extern void ScaleSamples(float* samples, int count, float gain);
+}
@@ -0,0 +1,159 @@
+// --------------------------------------------------------------------------
+// Decode tuning options
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <windows.h>
+
+#include "UnityPlugin.h"
+#include "PluginUtils.h"
+#include "DecodeOptions.h"
+
+namespace FPVR
+{
+	static const DecodeOptions gDecodePresets[DecodePresetCount] =
+	{
+		// threads, skip loopfilter, skip frame, file caching, network caching, clock jitter
+		{ DecodeOptionDefault, DecodeOptionDefault, DecodeOptionDefault, DecodeOptionDefault, DecodeOptionDefault, DecodeOptionDefault },	// DecodePresetDefault
+		{ 0, 0, 0, 50, 150, 0 },						// DecodePresetLowLatency
+		{ 2, 4, 1, DecodeOptionDefault, DecodeOptionDefault, DecodeOptionDefault },	// DecodePresetLowCPU
+		{ 0, 0, 0, 1000, 3000, DecodeOptionDefault },	// DecodePresetQuality
+	};
+
+	// Fill options with a preset
+	bool GetDecodePreset(eDecodePreset preset, DecodeOptions* options)
+	{
+		bool valid = (preset >= DecodePresetDefault && preset < DecodePresetCount);
+		*options = gDecodePresets[valid ? preset : DecodePresetDefault];
+		return valid;
+	}
+
+	// Add a single integer option to media unless it is DecodeOptionDefault
+	static void AddIntOption(libvlc_media_t* media, const char* name, int32_t value)
+	{
+		if (value != DecodeOptionDefault)
+		{
+			char option[64];
+			_snprintf_s(option, sizeof(option), _TRUNCATE, ":%s=%d", name, value);
+			libvlc_media_add_option(media, option);
+		}
+	}
+
+	// Add options that are not DecodeOptionDefault to media
+	void ApplyDecodeOptions(libvlc_media_t* media, const DecodeOptions& options)
+	{
+		AddIntOption(media, "avcodec-threads", options.mDecodeThreads);
+		AddIntOption(media, "avcodec-skip-loopfilter", options.mSkipLoopFilter);
+		AddIntOption(media, "avcodec-skip-frame", options.mSkipFrame);
+		AddIntOption(media, "file-caching", options.mFileCaching);
+		AddIntOption(media, "network-caching", options.mNetworkCaching);
+		AddIntOption(media, "clock-jitter", options.mClockJitter);
+	}
+
+	// Process CPU time in seconds (user + kernel)
+	static double ProcessCPUSeconds()
+	{
+		FILETIME creation, exit, kernel, user;
+		if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		{
+			return 0.0;
+		}
+		uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+		uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+		return (double)(k + u) * 1e-7;
+	}
+
+	// Frame memory for benchmark players, contents are never read
+	static void* BenchLockCB(void* opaque, void** planes)
+	{
+		*planes = opaque;
+		return nullptr;
+	}
+
+	static void BenchUnlockCB(void* opaque, void* picture, void* const* planes)
+	{
+	}
+
+	static void BenchDisplayCB(void* opaque, void* picture)
+	{
+	}
+
+	// Play up to duration ms of a clip under each preset and record CPU time and frame counts.
+	// Audio is disabled so the figures are for video decode, CPU time is for the whole process so
+	// other work in the process should be idle while this runs.
+	int BenchmarkDecodePresets(const char* path, int64_t duration, DecodeBenchmarkResult* results, int maxResults)
+	{
+		static const int kWidth = 1280;
+		static const int kHeight = 720;
+
+		libvlc_instance_t* instance = libvlc_new(0, NULL);
+		if (instance == nullptr)
+		{
+			return 0;
+		}
+
+		std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+		bool isURL = PathIsURL(path);
+		int count = 0;
+
+		for (int preset = 0; preset < DecodePresetCount && count < maxResults; preset++)
+		{
+			libvlc_media_t* media = (isURL ? libvlc_media_new_location(instance, path) : libvlc_media_new_path(instance, path));
+			if (media == nullptr)
+			{
+				break;
+			}
+			DecodeOptions options;
+			GetDecodePreset((eDecodePreset)preset, &options);
+			ApplyDecodeOptions(media, options);
+			libvlc_media_add_option(media, ":no-audio");
+
+			libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+			if (player == nullptr)
+			{
+				libvlc_media_release(media);
+				break;
+			}
+			libvlc_video_set_callbacks(player, BenchLockCB, BenchUnlockCB, BenchDisplayCB, pixels.data());
+			libvlc_video_set_format(player, "RGBA", kWidth, kHeight, kWidth * 4);
+
+			double cpuStart = ProcessCPUSeconds();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			libvlc_media_player_play(player);
+			for (;;)
+			{
+				Sleep(50);
+				int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+				libvlc_state_t state = libvlc_media_player_get_state(player);
+				if (elapsed >= duration || state == libvlc_Ended || state == libvlc_Error)
+				{
+					break;
+				}
+			}
+
+			libvlc_media_stats_t stats;
+			memset(&stats, 0, sizeof(stats));
+			libvlc_media_get_stats(media, &stats);
+			libvlc_media_player_stop(player);
+
+			DecodeBenchmarkResult& r = results[count++];
+			r.mPreset = preset;
+			r.mDecodedFrames = stats.i_decoded_video;
+			r.mDisplayedFrames = stats.i_displayed_pictures;
+			r.mDroppedFrames = stats.i_lost_pictures;
+			r.mCPUSeconds = ProcessCPUSeconds() - cpuStart;
+			r.mWallSeconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0;
+
+			DebugLog("BenchmarkDecodePresets() preset %d: decoded %d, displayed %d, dropped %d, cpu %.3fs, wall %.3fs",
+				preset, r.mDecodedFrames, r.mDisplayedFrames, r.mDroppedFrames, r.mCPUSeconds, r.mWallSeconds);
+
+			libvlc_media_player_release(player);
+			libvlc_media_release(media);
+		}
+		libvlc_release(instance);
+		return count;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vlc/vlc.h>
+
+// --------------------------------------------------------------------------
+// Decode tuning options
+//
+// Typed equivalents of the libvlc options that trade decode cost against
+// latency and quality. They are applied per player as media options when the
+// player is prepared. Any field set to DecodeOptionDefault leaves libvlc's own
+// default in place. The sentinel is INT32_MIN rather than -1 as -1 is a
+// meaningful value for the skip options (discard nothing).
+
+namespace FPVR
+{
+	static const int32_t DecodeOptionDefault = INT32_MIN;
+
+	// Decode options (blittable, shared with C#)
+	typedef struct
+	{
+		int32_t mDecodeThreads;		// avcodec-threads: decoder threads (0 = automatic)
+		int32_t mSkipLoopFilter;	// avcodec-skip-loopfilter: -1 none, 0 default, 1 non-ref, 2 bidir, 3 non-key, 4 all
+		int32_t mSkipFrame;			// avcodec-skip-frame: -1 none, 0 default, 1 non-ref, 2 bidir, 3 non-key, 4 all
+		int32_t mFileCaching;		// file-caching: ms of local file data buffered
+		int32_t mNetworkCaching;	// network-caching: ms of network data buffered
+		int32_t mClockJitter;		// clock-jitter: ms of clock jitter absorbed before resynchronising
+	} DecodeOptions;
+
+	// Preset option sets
+	typedef enum
+	{
+		DecodePresetDefault = 0,	// libvlc defaults
+		DecodePresetLowLatency = 1,	// Minimal buffering, fast clock resync
+		DecodePresetLowCPU = 2,		// Skip loop filter and non-reference frames where possible
+		DecodePresetQuality = 3,	// Full decode, generous buffering
+		DecodePresetCount = 4
+	} eDecodePreset;
+
+	// Result of running a clip under one preset
+	typedef struct
+	{
+		int32_t mPreset;			// eDecodePreset
+		int32_t mDecodedFrames;		// Video frames decoded
+		int32_t mDisplayedFrames;	// Video frames displayed
+		int32_t mDroppedFrames;		// Video frames lost (decoded late or skipped)
+		double mCPUSeconds;			// Process CPU time used (user + kernel)
+		double mWallSeconds;		// Elapsed time
+	} DecodeBenchmarkResult;
+
+	// Fill options with a preset (returns false and defaults if preset is unknown)
+	extern bool GetDecodePreset(eDecodePreset preset, DecodeOptions* options);
+
+	// Add options that are not DecodeOptionDefault to media (before it is played)
+	extern void ApplyDecodeOptions(libvlc_media_t* media, const DecodeOptions& options);
+
+	// Play up to duration ms of a clip under each preset (video only, decoded into memory) and
+	// record CPU time and frame counts. Uses its own libvlc instance and blocks for roughly
+	// DecodePresetCount * duration. Returns number of results written.
+	extern int BenchmarkDecodePresets(const char* path, int64_t duration, DecodeBenchmarkResult* results, int maxResults);
+}
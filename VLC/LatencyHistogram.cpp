@@ -0,0 +1,115 @@
+// ---------------------------------------------------------------------------
+// Latency Histogram Class
+//
+// Lock-free log-linear histogram of stage durations
+
+#include <chrono>
+
+#include "LatencyHistogram.h"
+
+namespace FPVR
+{
+	// Monotonic time used to measure stages (microseconds)
+	int64_t LatencyHistogram::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Bucket a duration falls in. Durations below SubBuckets have a bucket each, above that the
+	// top three bits pick the bucket (power of two and which quarter of it).
+	int LatencyHistogram::BucketIndex(int64_t duration)
+	{
+		if (duration < SubBuckets)
+		{
+			return (duration > 0 ? (int)duration : 0);
+		}
+		if (duration >= ((int64_t)1 << MaxPower))
+		{
+			return NumBuckets - 1;
+		}
+
+		int power = 2;
+		while ((duration >> (power + 1)) != 0)
+		{
+			power++;
+		}
+		int sub = (int)(duration >> (power - 2)) & (SubBuckets - 1);
+		return (power - 1) * SubBuckets + sub;
+	}
+
+	// Duration a bucket reports (the middle of its range)
+	int64_t LatencyHistogram::BucketValue(int index)
+	{
+		if (index < SubBuckets)
+		{
+			return index;
+		}
+		int power = index / SubBuckets + 1;
+		int sub = index % SubBuckets;
+		int64_t width = (int64_t)1 << (power - 2);
+		return (SubBuckets + sub) * width + width / 2;
+	}
+
+	// Record a duration
+	void LatencyHistogram::Add(int64_t duration)
+	{
+		mCounts[BucketIndex(duration)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Estimate the duration below which fraction of samples fall
+	int64_t LatencyHistogram::Percentile(double fraction) const
+	{
+		uint32_t counts[NumBuckets];
+		uint64_t total = 0;
+		for (int i = 0; i < NumBuckets; i++)
+		{
+			counts[i] = mCounts[i].load(std::memory_order_relaxed);
+			total += counts[i];
+		}
+		if (total == 0)
+		{
+			return 0;
+		}
+
+		// Rank of the sample wanted (1 based)
+		uint64_t rank = (uint64_t)(fraction * (double)total + 0.5);
+		rank = (rank < 1 ? 1 : (rank > total ? total : rank));
+
+		uint64_t seen = 0;
+		for (int i = 0; i < NumBuckets; i++)
+		{
+			seen += counts[i];
+			if (seen >= rank)
+			{
+				return BucketValue(i);
+			}
+		}
+		return BucketValue(NumBuckets - 1);
+	}
+
+	// Number of samples recorded
+	uint64_t LatencyHistogram::Count() const
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < NumBuckets; i++)
+		{
+			total += mCounts[i].load(std::memory_order_relaxed);
+		}
+		return total;
+	}
+
+	// Discard all samples
+	void LatencyHistogram::Reset()
+	{
+		for (int i = 0; i < NumBuckets; i++)
+		{
+			mCounts[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	// Constructor: start empty
+	LatencyHistogram::LatencyHistogram()
+	{
+		Reset();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Latency Histogram Class
+//
+// Lock-free histogram of durations in microseconds for reporting percentiles
+// of pipeline stages. Buckets are log-linear (four per power of two) so a
+// percentile is accurate to within about 12% from 1us up to ~67s, anything
+// longer lands in the last bucket. Adding a sample is one relaxed atomic
+// increment so any thread may record while another reads.
+//
+// Histograms are embedded in the object whose stages they measure.
+
+namespace FPVR
+{
+	class LatencyHistogram
+	{
+	public:
+		static const int SubBuckets = 4;		// Buckets per power of two
+		static const int MaxPower = 26;			// Samples of 2^MaxPower microseconds or more share the last bucket
+		static const int NumBuckets = (MaxPower - 1) * SubBuckets;
+
+		// Monotonic time used to measure stages (microseconds)
+		static int64_t Now();
+
+		// Record a duration (negative durations count as 0)
+		void Add(int64_t duration);
+
+		// Record the time since start (a time returned by Now)
+		void AddSince(int64_t start) { Add(Now() - start); }
+
+		// Estimate the duration below which fraction (0..1) of samples fall, 0 if there are none
+		int64_t Percentile(double fraction) const;
+
+		// Number of samples recorded
+		uint64_t Count() const;
+
+		// Discard all samples (samples added meanwhile may or may not be kept)
+		void Reset();
+
+		LatencyHistogram();
+
+	protected:
+		std::atomic<uint32_t> mCounts[NumBuckets];
+
+		// Bucket a duration falls in and the duration a bucket reports
+		static int BucketIndex(int64_t duration);
+		static int64_t BucketValue(int index);
+	};
+}
@@ -7,6 +7,10 @@
 
 #include "UnityPlugin.h"
 #include "VLCMediaPlayer.h"
+#include "MediaInfoCache.h"
+#include "Thumbnailer.h"
+#include "PlayerRegistry.h"
+#include "PlayerCommands.h"
 #include "LibVLCWrapper.h"
 
 using namespace FPVR;
@@ -45,6 +49,287 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_Reset()
 	}
 }
 
+// ---------------------------------------------------------------------------------------------
+// Additional players, addressed by handle (handle 0 is the default player)
+
+// Create a player, returns its handle (-1 on failure or if there are already 64)
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_CreatePlayer()
+{
+	VLCMediaPlayer* player = VLCMediaPlayer::Create();
+	if (player == nullptr)
+	{
+		return -1;
+	}
+	int handle = AddPlayer(player);
+	if (handle < 0)
+	{
+		player->Release();
+	}
+	return handle;
+}
+
+// Release a player created by VLCMP_CreatePlayer
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_ReleasePlayer(int handle)
+{
+	VLCMediaPlayer* player = RemovePlayer(handle);
+	if (player != nullptr)
+	{
+		player->Release();
+	}
+}
+
+// Set the path to the media a player is to play
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerSetDataSource(int handle, const char* path)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->SetDataSource(path);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Set the surface a player plays back to
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerSetTexture(int handle, void* texturePtr, int width, int height, int format)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->SetTexture(texturePtr, width, height, GetTexFmtFromUnity(format));
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Get a player ready to play once its data source and surface are set
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerPrepareAsync(int handle)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->PrepareAsync();
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Returns the status block a player publishes each update (see VLCMP_GetStatusBlock)
+extern "C" const MPStatus* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerGetStatusBlock(int handle)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->GetStatusBlock();
+	}
+	else
+	{
+		return nullptr;
+	}
+}
+
+// Returns whether a specific channel of a player's audio is stereo (or not)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerIsAudioChannelStereo(int handle, int channel)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->IsAudioChannelStereo(channel);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Returns a player's channel frequency in Hz
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerChannelFrequency(int handle, int channel)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		return player->ChannelFrequency(channel);
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// As VLCMP_RetrievAudioData for a player. Every player with audio must be drained (this or
+// VLCMP_PlayerRetrieveAudioDataPlanar), otherwise its audio buffer stays full, volume changes
+// are never heard and libvlc waits out its drain timeout at the end of the media.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerRetrieveAudioData(int handle, int channel, float* buffer, int maxLength, int* floatsCopied)
+{
+	return PlayerRetrieveAudioData(handle, channel, buffer, maxLength, floatsCopied);
+}
+
+// As VLCMP_RetrieveAudioDataPlanar for a player
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerRetrieveAudioDataPlanar(int handle, float* buffer, int numChannels, int maxFrames, int* framesCopied)
+{
+	return PlayerRetrieveAudioDataPlanar(handle, buffer, numChannels, maxFrames, framesCopied);
+}
+
+// Enable or disable looping for a player (see VLCMP_SetLooping)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerSetLooping(int handle, bool loop)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr)
+	{
+		player->SetLooping(loop);
+	}
+}
+
+// Copy a player's statistics to stats, returns false if handle is not valid
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PlayerGetStats(int handle, MPStats* stats)
+{
+	VLCMediaPlayer* player = FindPlayer(handle);
+	if (player != nullptr && stats != nullptr)
+	{
+		player->GetStats(stats);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Run a packed array of commands (play, pause, seek, volume, rate, poll) against any players
+// in one call. Each command gets a result, events retrieved by polls are appended to events
+// (up to maxEvents). Polling a player does its per frame update so replaces VLCMP_Update.
+// Returns the number of events retrieved.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SubmitCommands(const MPCommand* commands, int numCommands, MPCommandResult* results, MPEvent* events, int maxEvents)
+{
+	int numEvents = 0;
+	if (commands != nullptr && results != nullptr && numCommands > 0)
+	{
+		numEvents = SubmitCommands(commands, numCommands, results, events, maxEvents);
+	}
+	DebugLogDeliver();
+	return numEvents;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Media info cache
+
+// Open the persistent media info cache (call once at startup, shared by all players)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_OpenMediaInfoCache(const char* path)
+{
+	if (gMediaInfoCache == nullptr)
+	{
+		gMediaInfoCache = MediaInfoCache::Create(path);
+	}
+	return (gMediaInfoCache != nullptr);
+}
+
+// Save any newly probed media info and close the cache
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_CloseMediaInfoCache()
+{
+	if (gMediaInfoCache != nullptr)
+	{
+		gMediaInfoCache->Release();
+		gMediaInfoCache = nullptr;
+	}
+}
+
+// Retrieve cached media info for a path or URL without creating a player. Returns false
+// if the media has not been probed or has changed since it was probed.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetCachedMediaInfo(const char* path, const char* etag, MediaInfo* info)
+{
+	MediaInfoKey key;
+	if (gMediaInfoCache != nullptr
+		&& path != nullptr
+		&& info != nullptr
+		&& MediaInfoCache::MakeKey(path, PathIsURL(path), etag, &key))
+	{
+		return gMediaInfoCache->Lookup(key, info);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+// Thumbnailer
+
+// Start the background thumbnailer with numWorkers threads (0 = one per core), atlases are
+// cached in cacheDir (may be null). Independent of the media player.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_CreateThumbnailer(int numWorkers, const char* cacheDir)
+{
+	if (gThumbnailer == nullptr)
+	{
+		gThumbnailer = Thumbnailer::Create(numWorkers, cacheDir);
+	}
+	return (gThumbnailer != nullptr);
+}
+
+// Stop the thumbnailer, outstanding requests are discarded
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_ReleaseThumbnailer()
+{
+	if (gThumbnailer != nullptr)
+	{
+		gThumbnailer->Release();
+		gThumbnailer = nullptr;
+	}
+}
+
+// Queue extraction of count thumbnails (times in ms) of thumbWidth x thumbHeight packed into an
+// RGBA atlas columns wide. Returns request id or 0 on error.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_RequestThumbnails(const char* path, const int64_t* times, int count, int thumbWidth, int thumbHeight, int columns)
+{
+	if (gThumbnailer != nullptr)
+	{
+		return gThumbnailer->Request(path, times, count, thumbWidth, thumbHeight, columns);
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// Returns request status (eThumbStatus) and atlas size in pixels
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetThumbnailStatus(int id, int* atlasWidth, int* atlasHeight)
+{
+	if (gThumbnailer != nullptr && atlasWidth != nullptr && atlasHeight != nullptr)
+	{
+		return gThumbnailer->GetStatus(id, atlasWidth, atlasHeight);
+	}
+	else
+	{
+		return ThumbUnknown;
+	}
+}
+
+// Copy a ready atlas (width * height * 4 bytes) to buffer
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_CopyThumbnailAtlas(int id, void* buffer, int size)
+{
+	if (gThumbnailer != nullptr && buffer != nullptr)
+	{
+		return gThumbnailer->CopyAtlas(id, buffer, size);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Discard a request once its atlas has been copied (or to cancel it)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_ForgetThumbnails(int id)
+{
+	if (gThumbnailer != nullptr)
+	{
+		gThumbnailer->Forget(id);
+	}
+}
+
 // ---------------------------------------------------------------------------------------------
 // Setup functions, these must be called prior to calling prepare
 
@@ -61,6 +346,61 @@ extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDataSource(c
 	}
 }
 
+// Set the path to a URL to be played along with the ETag identifying its version (used as
+// the validator for the media info cache)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDataSourceWithETag(const char* path, const char* etag)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->SetDataSource(path, etag);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Queue media to play gaplessly when the current media ends (nullptr clears the queued item)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetNextDataSource(const char* path)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->SetNextDataSource(path);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Play media from a memory region, which must stay valid until the player is reset or given
+// another data source. libvlc reads it directly (requires libvlc 3.0, otherwise returns false).
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDataSourceMemory(const void* data, uint64_t size)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->SetDataSourceMemory(data, size);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Play media stored at offset in a pack file (size 0 = to end of file). The pack file is memory
+// mapped and libvlc reads the region directly (requires libvlc 3.0, otherwise returns false).
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDataSourcePackFile(const char* path, uint64_t offset, uint64_t size)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->SetDataSourcePackFile(path, offset, size);
+	}
+	else
+	{
+		return false;
+	}
+}
+
 // Set the surface the media is to be played back to
 extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetTexture(void* texturePtr, int width, int height, int format)
 {
@@ -197,6 +537,127 @@ extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_RetrievAudioData
 	}
 }
 
+// Fills a planar buffer (numChannels blocks of maxFrames floats) with up to maxFrames frames of every
+// channel in one call. Returns the number of frames still available, framesCopied indicates how many
+// were returned.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_RetrieveAudioDataPlanar(float* buffer, int numChannels, int maxFrames, int* framesCopied)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->RetrieveAudioDataPlanar(buffer, numChannels, maxFrames, framesCopied);
+	}
+	else
+	{
+		*framesCopied = 0;
+		return 0;
+	}
+}
+
+// Set decode tuning options (applied when the media is next prepared), fields of INT32_MIN
+// (DecodeOptionDefault) keep the libvlc default
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDecodeOptions(const DecodeOptions* options)
+{
+	if (gVLCMediaPlayer != nullptr && options != nullptr)
+	{
+		gVLCMediaPlayer->SetDecodeOptions(*options);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Set decode tuning options from a preset (eDecodePreset: 0 = default, 1 = low latency,
+// 2 = low CPU, 3 = quality)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetDecodePreset(int preset)
+{
+	DecodeOptions options;
+	if (gVLCMediaPlayer != nullptr && GetDecodePreset((eDecodePreset)preset, &options))
+	{
+		gVLCMediaPlayer->SetDecodeOptions(options);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Retrieve the options a preset uses (eg. as a starting point for custom options)
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetDecodePreset(int preset, DecodeOptions* options)
+{
+	if (options != nullptr)
+	{
+		return GetDecodePreset((eDecodePreset)preset, options);
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Play up to duration ms of a clip under each preset and report CPU time and frame counts.
+// Blocks for several times duration, run from a worker thread. Returns number of results.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_BenchmarkDecodePresets(const char* path, int64_t duration, DecodeBenchmarkResult* results, int maxResults)
+{
+	if (path != nullptr && results != nullptr && maxResults > 0 && duration > 0)
+	{
+		return BenchmarkDecodePresets(path, duration, results, maxResults);
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// Set the sample rate audio is delivered at (normally Unity's AudioSettings.outputSampleRate)
+// and the resampler quality (0 = fast, 1 = medium, 2 = high, 3 = best)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetAudioOutputFormat(int sampleRate, int quality)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetAudioOutputFormat(sampleRate, (eResampleQuality)quality);
+	}
+}
+
+// Set the latency between audio being retrieved and it being heard in microseconds (eg. Unity's
+// DSP buffer length * number of buffers / output rate)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetAudioOutputLatency(int64_t latency)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetAudioOutputLatency(latency);
+	}
+}
+
+// Returns how late (positive) or early (negative) audio is heard compared to libvlc's clock in
+// microseconds, video presentation is delayed by this amount
+extern "C" int64_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetAVSyncOffset()
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->GetAVSyncOffset();
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// Measure resampler cost, returns microseconds of CPU per channel-second of output. Blocks for
+// a few hundred milliseconds so call from a loading screen or tool, not during playback.
+extern "C" double UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_BenchmarkResampler(int quality, int channels, int inRate, int outRate)
+{
+	if (quality < ResampleFast || quality >= ResampleQualityCount
+		|| channels <= 0 || channels > AudioResampler::MaxChannels
+		|| inRate <= 0 || outRate <= 0)
+	{
+		return 0.0;
+	}
+	return AudioResampler::Benchmark((eResampleQuality)quality, channels, inRate, outRate);
+}
+
 // If returns true then retrieves next event, otherwise returns false and mpEvent unchanged
 extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetMediaEvent(eMPEvent* mpEvent, int64_t* param)
 {
@@ -210,6 +671,33 @@ extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetMediaEvent(e
 	}
 }
 
+// Retrieves up to maxEvents pending events in order (one call per frame rather than one per
+// event), returns number retrieved
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetMediaEvents(MPEvent* mpEvents, int maxEvents)
+{
+	if (gVLCMediaPlayer != nullptr && mpEvents != nullptr && maxEvents > 0)
+	{
+		return gVLCMediaPlayer->GetMediaEvents(mpEvents, maxEvents);
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// Returns number of events dropped because the event queue was full
+extern "C" uint64_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetMediaEventOverflowCount()
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->GetMediaEventOverflowCount();
+	}
+	else
+	{
+		return 0;
+	}
+}
+
 // Having specified data source and surface, this function gets ready to play. Once
 // play starts we should have valid info about the video (readable/playable, width, height
 // and possibly duration).
@@ -225,22 +713,23 @@ extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_PrepareAsync()
 	}
 }
 
-// Call once per frame from the thread to complete updates.
+// Call once per frame from the thread to complete updates. Also delivers batched log lines
+// to the debug callback.
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_Update()
 {
 	if (gVLCMediaPlayer != nullptr)
 	{
 		gVLCMediaPlayer->Update();
 	}
+	DebugLogDeliver();
 }
 
-// Call render function to update texture with latest video frame
+// Call render function to update textures with latest video frames. The event ID selects the
+// players (see VLCMP_GetRenderEventID), other IDs update the default player and any players
+// created with VLCMP_CreatePlayer.
 static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
 {
-	if (gVLCMediaPlayer != nullptr)
-	{
-		gVLCMediaPlayer->Render();
-	}
+	RenderEvent(eventID);
 }
 
 // GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
@@ -249,6 +738,20 @@ extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_
 	return OnRenderEvent;
 }
 
+// Get the render event ID that updates just one player (0 = default player), or with a handle
+// of -1 the ID that updates every player with a new frame in one batch
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetRenderEventID(int player)
+{
+	if (player < 0)
+	{
+		return RenderEventDirty;
+	}
+	else
+	{
+		return RenderEventPlayer | player;
+	}
+}
+
 // Start playing from current position (if immediately after Prepare then from beginning)
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_Play()
 {
@@ -280,6 +783,121 @@ extern "C" int64_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetCurrentPo
 	}
 }
 
+// Seek to specified position in milliseconds using mode (eSeekMode: 0 = fast, 1 = accurate).
+// OnSeekComplete is sent when the first frame after the seek arrives.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SeekToWithMode(int64_t pos, int mode)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SeekTo(pos, (mode == SeekFast ? SeekFast : SeekAccurate));
+	}
+}
+
+// Set audio volume (1 = unchanged)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetVolume(float volume)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetVolume(volume);
+	}
+}
+
+// Set playback rate (1 = normal speed)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetRate(float rate)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetRate(rate);
+	}
+}
+
+// Enable or disable the performance HUD drawn into the top left of the video
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetHudEnabled(bool enable)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetHudEnabled(enable);
+	}
+}
+
+// Enable or disable looping. Enabled before PrepareAsync the media wraps to the start without
+// restarting the decoders (MPStats reports the gap at each wrap).
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetLooping(bool loop)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetLooping(loop);
+	}
+}
+
+// Enable or disable scrubbing: seeks are coalesced and use keyframes, numDecoders secondary
+// decoders (up to 4) are parked spacing milliseconds apart around the cursor
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SetScrubMode(bool enable, int numDecoders, int64_t spacing)
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		gVLCMediaPlayer->SetScrubMode(enable, numDecoders, spacing);
+	}
+}
+
+// Returns the status block the player publishes each update: state, position, duration,
+// dimensions, buffering and frame counters under a seqlock, readable through the pointer
+// without further calls until the player is released (see PlayerStatus.h)
+extern "C" const MPStatus* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetStatusBlock()
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->GetStatusBlock();
+	}
+	else
+	{
+		return nullptr;
+	}
+}
+
+// Copy a consistent snapshot of the player's status block, returns false if there is no player
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetStatus(MPStatus* status)
+{
+	if (gVLCMediaPlayer != nullptr && status != nullptr)
+	{
+		ReadStatus(gVLCMediaPlayer->GetStatusBlock(), status);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Copy player statistics to stats, returns false if there is no player. Lock free on the playback
+// paths and cheap enough to poll every frame.
+extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetStats(MPStats* stats)
+{
+	if (gVLCMediaPlayer != nullptr && stats != nullptr)
+	{
+		gVLCMediaPlayer->GetStats(stats);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+// Retrieve current playback position in microseconds, interpolated between libvlc's time
+// reports so smooth enough to animate against
+extern "C" int64_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_GetCurrentPositionUs()
+{
+	if (gVLCMediaPlayer != nullptr)
+	{
+		return gVLCMediaPlayer->GetCurrentPositionUs();
+	}
+	else
+	{
+		return 0;
+	}
+}
+
 // Seek to specified position (if seekable)
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API VLCMP_SeekTo(int64_t pos)
 {
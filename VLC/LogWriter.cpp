@@ -0,0 +1,216 @@
+// ---------------------------------------------------------------------------
+// Log Writer Class
+//
+// Asynchronous debug log drained to file by a background thread
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "LogWriter.h"
+
+namespace FPVR
+{
+	// Producer: claim a line, returns nullptr (and counts a drop) if the ring is full
+	LogWriter::sLine* LogWriter::Claim(uint32_t* pos)
+	{
+		sLine* line = mRing.Claim(pos);
+		if (line == nullptr)
+		{
+			mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		return line;
+	}
+
+	// Producer: format a line directly into a claimed slot
+	bool LogWriter::WriteV(const char* format, va_list args)
+	{
+		uint32_t pos;
+		sLine* line = Claim(&pos);
+		if (line == nullptr)
+		{
+			return false;
+		}
+		int len = _vsnprintf_s(line->mText, sizeof(line->mText), _TRUNCATE, format, args);
+		line->mLength = (len >= 0 ? len : (int)strlen(line->mText));
+		mRing.Publish(pos);
+		return true;
+	}
+
+	// Producer: copy a line into a claimed slot
+	bool LogWriter::Write(const char* str)
+	{
+		uint32_t pos;
+		sLine* line = Claim(&pos);
+		if (line == nullptr)
+		{
+			return false;
+		}
+		size_t len = strlen(str);
+		len = (len < (size_t)MaxLineLength ? len : (size_t)MaxLineLength);
+		memcpy(line->mText, str, len);
+		line->mText[len] = '\0';
+		line->mLength = (int)len;
+		mRing.Publish(pos);
+		return true;
+	}
+
+	// Writer thread: append published lines to buffer and free their slots. A claimed line that
+	// is still being formatted ends the batch so lines stay in order.
+	int LogWriter::Drain(std::string& buffer)
+	{
+		int lines = 0;
+		for (const sLine* line = mRing.Peek(); line != nullptr; line = mRing.Peek())
+		{
+			buffer.append(line->mText, line->mLength);
+			buffer.push_back('\n');
+			mRing.Pop();
+			lines++;
+		}
+
+		uint64_t dropped = mDroppedCount.load(std::memory_order_relaxed);
+		if (dropped != mDroppedReported)
+		{
+			char note[64];
+			_snprintf_s(note, sizeof(note), _TRUNCATE, "LogWriter: %I64u lines dropped\n", dropped - mDroppedReported);
+			buffer.append(note);
+			mDroppedReported = dropped;
+		}
+		return lines;
+	}
+
+	// Enable or disable forwarding of written lines, anything not yet collected is discarded
+	// when forwarding is turned off
+	void LogWriter::SetForwarding(bool forward)
+	{
+		mForwarding = forward;
+		if (!forward)
+		{
+			std::lock_guard<std::mutex> lock(mForwardMutex);
+			mForwarded.clear();
+		}
+	}
+
+	// Swap out all forwarded lines into text (whose previous contents are discarded)
+	bool LogWriter::TakeForwarded(std::string& text)
+	{
+		text.clear();
+		std::lock_guard<std::mutex> lock(mForwardMutex);
+		if (mForwardDropped != 0)
+		{
+			char note[64];
+			_snprintf_s(note, sizeof(note), _TRUNCATE, "LogWriter: %I64u lines not forwarded\n", mForwardDropped);
+			mForwarded.append(note);
+			mForwardDropped = 0;
+		}
+		mForwarded.swap(text);
+		return !text.empty();
+	}
+
+	// Writer thread main loop: every WriteInterval (or on quit) write everything queued with
+	// one buffered write and flush, and forward the batch if enabled. The file is only opened
+	// once there is something to write.
+	void LogWriter::Run()
+	{
+		static const int kBufferSize = 64 * 1024;
+
+		FILE* fp = nullptr;
+		std::string buffer;
+		buffer.reserve(kBufferSize);
+		for (;;)
+		{
+			bool quit = mQuit.load(std::memory_order_acquire);
+
+			buffer.clear();
+			Drain(buffer);
+			if (!buffer.empty())
+			{
+				if (fp == nullptr && fopen_s(&fp, mPath.c_str(), "a+") == 0)
+				{
+					setvbuf(fp, nullptr, _IOFBF, kBufferSize);
+				}
+				if (fp != nullptr)
+				{
+					fwrite(buffer.data(), 1, buffer.size(), fp);
+					fflush(fp);
+				}
+
+				// A collector that has stopped collecting loses the batch rather than growing
+				// the buffer without limit
+				if (mForwarding)
+				{
+					std::lock_guard<std::mutex> lock(mForwardMutex);
+					if (mForwarded.size() + buffer.size() <= (size_t)MaxForwardBytes)
+					{
+						mForwarded.append(buffer);
+					}
+					else
+					{
+						mForwardDropped += (uint64_t)std::count(buffer.begin(), buffer.end(), '\n');
+					}
+				}
+			}
+
+			if (quit)
+			{
+				break;
+			}
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWake.wait_for(lock, std::chrono::milliseconds(WriteInterval), [this] { return mQuit.load(std::memory_order_acquire); });
+		}
+
+		if (fp != nullptr)
+		{
+			fclose(fp);
+		}
+	}
+
+	// Create a writer appending to path
+	LogWriter* LogWriter::Create(const char* path, int capacity)
+	{
+		assert(path != nullptr && capacity > 0 && capacity <= (1 << 20));
+		LogWriter* writer = new LogWriter(path, capacity);
+		writer->mThread = std::thread(&LogWriter::Run, writer);
+		return writer;
+	}
+
+	// Stop the writer thread after writing all queued lines and release the writer
+	void LogWriter::Release()
+	{
+		Stop();
+		delete this;
+	}
+
+	// Stop the writer thread after writing all queued lines, the ring stays allocated
+	void LogWriter::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+			mQuit = true;
+		}
+		mWake.notify_all();
+		if (mThread.joinable())
+		{
+			mThread.join();
+		}
+	}
+
+	// Constructor: the ring allocates the line storage
+	LogWriter::LogWriter(const char* path, int capacity)
+		: mRing(capacity)
+	{
+		mDroppedCount = 0;
+		mDroppedReported = 0;
+		mForwarding = false;
+		mForwardDropped = 0;
+		mPath = path;
+		mQuit = false;
+	}
+
+	// Destructor
+	LogWriter::~LogWriter()
+	{
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "MPSCRing.h"
+
+// ---------------------------------------------------------------------------
+// Log Writer Class
+//
+// Asynchronous debug log. Threads calling DebugLog format their line straight
+// into a bounded multiple producer / single consumer lock-free ring (an
+// MPSCRing, as used by the media event queue) and return, a background
+// thread drains the ring and appends the lines to the log file in batches
+// through a buffered stream that stays open. Lines arriving while the ring is
+// full are dropped and counted, nothing a producer does ever touches the file
+// or blocks on the writer.
+//
+// The writer thread can also forward the lines it writes to a second buffer
+// that is collected in one piece from a known thread (Unity's main thread),
+// so the managed debug callback is called once per batch rather than per line
+// from arbitrary libvlc threads.
+
+namespace FPVR
+{
+	class LogWriter
+	{
+	public:
+		static const int DefaultCapacity = 1024;	// Lines the ring holds
+		static const int MaxLineLength = 255;		// Longer lines are truncated
+		static const int WriteInterval = 50;		// Milliseconds between drains when idle
+		static const int MaxForwardBytes = 256 * 1024;	// Forwarded text held for collection before lines are dropped
+
+		// Create a writer appending to path with room for capacity lines (rounded up to a power
+		// of two). The file is opened by the writer thread.
+		static LogWriter* Create(const char* path, int capacity = DefaultCapacity);
+
+		// Stop the writer thread after writing all queued lines and release the writer
+		void Release();
+
+		// Stop the writer thread after writing all queued lines but keep the ring, so producers
+		// that already hold the writer can still safely write to it (their lines are dropped
+		// once the ring fills). Safe to call more than once.
+		void Stop();
+
+		// Producer: queue a printf style line, returns false (and counts a drop) if the ring is full
+		bool WriteV(const char* format, va_list args);
+
+		// Producer: queue a line, returns false (and counts a drop) if the ring is full
+		bool Write(const char* str);
+
+		// Lines dropped because the ring was full
+		uint64_t DroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+		// Enable or disable forwarding of written lines for collection by TakeForwarded
+		void SetForwarding(bool forward);
+
+		// Swap out all forwarded lines (newline separated) into text, returns false if there are none
+		bool TakeForwarded(std::string& text);
+
+	protected:
+		typedef struct
+		{
+			int mLength;						// Characters in mText
+			char mText[MaxLineLength + 1];
+		} sLine;
+
+		MPSCRing<sLine> mRing;					// Queued lines (consumed by the writer thread)
+
+		std::atomic<uint64_t> mDroppedCount;	// Lines dropped because the ring was full
+		uint64_t mDroppedReported;				// Drop count last noted in the file (writer thread only)
+
+		std::atomic<bool> mForwarding;			// True if written lines are also forwarded
+		std::mutex mForwardMutex;				// Protects mForwarded (writer thread and collector only)
+		std::string mForwarded;					// Lines waiting to be collected
+		uint64_t mForwardDropped;				// Lines not forwarded because mForwarded was full
+
+		std::string mPath;						// Log file path
+		std::mutex mWakeMutex;					// Used only to sleep the writer thread
+		std::condition_variable mWake;			// Signalled on quit
+		std::atomic<bool> mQuit;				// Set to stop the writer thread
+		std::thread mThread;					// Writer thread
+
+		// Producer: claim a line, returns nullptr (and counts a drop) if the ring is full
+		sLine* Claim(uint32_t* pos);
+
+		// Writer thread: append published lines to buffer, returns number of lines taken
+		int Drain(std::string& buffer);
+
+		// Writer thread main loop
+		void Run();
+
+		LogWriter(const char* path, int capacity);
+		~LogWriter();
+	};
+}
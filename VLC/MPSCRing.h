@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// MPSC Ring
+//
+// Bounded multiple producer / single consumer lock-free ring of fixed size
+// entries, used by the media event queue and the log writer.
+//
+// Each slot carries a sequence number (Vyukov's bounded MPMC scheme reduced to
+// a single consumer): producers claim a slot by advancing the enqueue position
+// with a CAS, fill the entry in place and publish it by storing the slot
+// sequence. The consumer takes entries in claim order, an entry that has been
+// claimed but not yet published ends the read so order is preserved. Nothing
+// is allocated after construction, when the ring is full Claim fails and the
+// caller decides what to drop.
+
+namespace FPVR
+{
+	template <typename T>
+	class MPSCRing
+	{
+	public:
+		// Allocate room for at least capacity entries (rounded up to a power of two), each slot's
+		// sequence starts at its index (free for lap 0)
+		explicit MPSCRing(int capacity)
+		{
+			assert(capacity > 0 && capacity <= (1 << 20));
+			uint32_t size = 1;
+			while (size < (uint32_t)capacity)
+			{
+				size <<= 1;
+			}
+			mSlots = new sSlot[size];
+			mMask = size - 1;
+			for (uint32_t i = 0; i < size; i++)
+			{
+				mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+			}
+			mEnqueuePos.store(0, std::memory_order_relaxed);
+			mDequeuePos = 0;
+		}
+
+		// Free entries (no producer or consumer may be active)
+		~MPSCRing()
+		{
+			delete[] mSlots;
+		}
+
+		// Producer: claim the next entry for writing, returns nullptr if the ring is full. The entry
+		// must be handed back with Publish(pos).
+		T* Claim(uint32_t* pos)
+		{
+			uint32_t p = mEnqueuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				sSlot* slot = &mSlots[p & mMask];
+				uint32_t sequence = slot->mSequence.load(std::memory_order_acquire);
+				int32_t diff = (int32_t)(sequence - p);
+				if (diff == 0)
+				{
+					// Slot is free, claim it (on failure p is reloaded)
+					if (mEnqueuePos.compare_exchange_weak(p, p + 1, std::memory_order_relaxed))
+					{
+						*pos = p;
+						return &slot->mEntry;
+					}
+				}
+				else if (diff < 0)
+				{
+					// Slot still holds an entry from the previous lap, ring is full
+					return nullptr;
+				}
+				else
+				{
+					// Another producer claimed this slot
+					p = mEnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Producer: make a claimed entry visible to the consumer
+		void Publish(uint32_t pos)
+		{
+			mSlots[pos & mMask].mSequence.store(pos + 1, std::memory_order_release);
+		}
+
+		// Consumer: oldest published entry without removing it, nullptr if there is none
+		const T* Peek() const
+		{
+			const sSlot* slot = &mSlots[mDequeuePos & mMask];
+			uint32_t sequence = slot->mSequence.load(std::memory_order_acquire);
+			if ((int32_t)(sequence - (mDequeuePos + 1)) < 0)
+			{
+				return nullptr;
+			}
+			return &slot->mEntry;
+		}
+
+		// Consumer: free the entry returned by Peek for the producers' next lap
+		void Pop()
+		{
+			mSlots[mDequeuePos & mMask].mSequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+			mDequeuePos++;
+		}
+
+		// Consumer: approximate number of entries claimed and not yet popped
+		int Depth() const { return (int)(mEnqueuePos.load(std::memory_order_relaxed) - mDequeuePos); }
+
+	protected:
+		typedef struct
+		{
+			std::atomic<uint32_t> mSequence;	// Slot position when free, position + 1 when published
+			T mEntry;
+		} sSlot;
+
+		sSlot* mSlots;							// Entry storage (mMask + 1 slots)
+		uint32_t mMask;							// Capacity - 1
+
+		char mPad0[64];							// Keeps positions on separate cache lines
+		std::atomic<uint32_t> mEnqueuePos;		// Next slot to claim (shared by producers)
+		char mPad1[60];
+		uint32_t mDequeuePos;					// Next slot to read (owned by consumer)
+		char mPad2[60];
+
+		MPSCRing(const MPSCRing&) = delete;
+		MPSCRing& operator=(const MPSCRing&) = delete;
+	};
+}
@@ -0,0 +1,213 @@
+// ---------------------------------------------------------------------------
+// Media Events
+//
+// Bounded multiple producer / single consumer lock-free queue of media events
+
+#include <cassert>
+#include <chrono>
+
+#include "MediaEvents.h"
+
+namespace FPVR
+{
+	// Returns the coalescing policy for an event type
+	eCoalescePolicy MediaEventQueue::GetCoalescePolicy(eMPEvent mpEvent)
+	{
+		return (GetLatestSlot(mpEvent) >= 0 ? KeepLatest : KeepAll);
+	}
+
+	// Returns coalesced slot index for event type (or -1 if not coalesced)
+	int MediaEventQueue::GetLatestSlot(eMPEvent mpEvent)
+	{
+		switch (mpEvent)
+		{
+		case OnPositionChanged:
+			return 0;
+		case OnBufferingProgress:
+			return 1;
+		default:
+			return -1;
+		}
+	}
+
+	// Returns event type held by a coalesced slot
+	eMPEvent MediaEventQueue::GetLatestSlotEvent(int slot)
+	{
+		static const eMPEvent kSlotEvents[NumLatestSlots] = { OnPositionChanged, OnBufferingProgress };
+		return kSlotEvents[slot];
+	}
+
+	// Monotonic time used to stamp events (microseconds)
+	int64_t MediaEventQueue::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Producer: add an event, returns false (and counts an overflow) if the queue is full
+	bool MediaEventQueue::Push(eMPEvent mpEvent, int64_t param)
+	{
+		int64_t timestamp = Now();
+		uint32_t eventSequence = mNextSequence.fetch_add(1, std::memory_order_relaxed);
+
+		int latest = GetLatestSlot(mpEvent);
+		if (latest >= 0)
+		{
+			// Replace the coalesced value, producers of the same type are serialised by a
+			// short spin (they are normally all libvlc's event thread)
+			sLatestSlot& ls = mLatest[latest];
+			ls.mLock.BeginWrite();
+			ls.mSequence.store(eventSequence, std::memory_order_relaxed);
+			ls.mParam.store(param, std::memory_order_relaxed);
+			ls.mTimestamp.store(timestamp, std::memory_order_relaxed);
+			ls.mLock.EndWrite();
+			return true;
+		}
+
+		uint32_t pos;
+		MPEvent* ev = mRing.Claim(&pos);
+		if (ev == nullptr)
+		{
+			mOverflowCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		ev->mMPEvent = mpEvent;
+		ev->mSequence = eventSequence;
+		ev->mParam = param;
+		ev->mTimestamp = timestamp;
+		mRing.Publish(pos);
+		return true;
+	}
+
+	// Consumer: read a coalesced slot, returns false if it holds no unread event. The read is
+	// retried if a producer updated the slot meanwhile.
+	bool MediaEventQueue::PeekLatest(int slot, MPEvent* mpEvent, uint32_t* version)
+	{
+		sLatestSlot& ls = mLatest[slot];
+		for (;;)
+		{
+			*version = ls.mLock.ReadBegin();
+			if (*version == ls.mTakenVersion)
+			{
+				return false;
+			}
+			mpEvent->mSequence = ls.mSequence.load(std::memory_order_relaxed);
+			mpEvent->mParam = ls.mParam.load(std::memory_order_relaxed);
+			mpEvent->mTimestamp = ls.mTimestamp.load(std::memory_order_relaxed);
+			if (ls.mLock.ReadValid(*version))
+			{
+				break;
+			}
+		}
+		mpEvent->mMPEvent = GetLatestSlotEvent(slot);
+		return true;
+	}
+
+	// Consumer: read queue head without removing it, returns false if the queue is empty. An event
+	// that has been claimed but not yet published ends the read so order is preserved.
+	bool MediaEventQueue::PeekQueue(MPEvent* mpEvent)
+	{
+		const MPEvent* head = mRing.Peek();
+		if (head == nullptr)
+		{
+			return false;
+		}
+		*mpEvent = *head;
+		return true;
+	}
+
+	// Consumer: remove the oldest event (queued or coalesced), returns false if there are none
+	bool MediaEventQueue::Pop(MPEvent* mpEvent)
+	{
+		MPEvent candidate;
+		uint32_t version;
+		uint32_t takenVersion = 0;
+		int source = -2;
+		if (PeekQueue(&candidate))
+		{
+			*mpEvent = candidate;
+			source = -1;
+		}
+		for (int i = 0; i < NumLatestSlots; i++)
+		{
+			// Sequences wrap so are compared by difference
+			if (PeekLatest(i, &candidate, &version) && (source == -2 || (int32_t)(candidate.mSequence - mpEvent->mSequence) < 0))
+			{
+				*mpEvent = candidate;
+				takenVersion = version;
+				source = i;
+			}
+		}
+
+		if (source == -1)
+		{
+			mRing.Pop();
+		}
+		else if (source >= 0)
+		{
+			// Each write advances the version by two, writes not returned were coalesced away
+			sLatestSlot& ls = mLatest[source];
+			uint32_t replaced = (takenVersion - ls.mTakenVersion) / 2 - 1;
+			if (replaced > 0)
+			{
+				mCoalescedCount.fetch_add(replaced, std::memory_order_relaxed);
+			}
+			ls.mTakenVersion = takenVersion;
+		}
+		return (source != -2);
+	}
+
+	// Consumer: remove up to maxEvents events in order, returns number removed
+	int MediaEventQueue::PopMany(MPEvent* mpEvents, int maxEvents)
+	{
+		int count = 0;
+		while (count < maxEvents && Pop(&mpEvents[count]))
+		{
+			count++;
+		}
+		return count;
+	}
+
+	// Consumer: discard all pending events
+	void MediaEventQueue::Clear()
+	{
+		MPEvent mpEvent;
+		while (Pop(&mpEvent))
+		{
+		}
+	}
+
+	// Create a queue able to hold at least capacity events (rounded up to a power of two)
+	MediaEventQueue* MediaEventQueue::Create(int capacity)
+	{
+		assert(capacity > 0 && capacity <= (1 << 20));
+		return new MediaEventQueue(capacity);
+	}
+
+	// Release the queue (no producer or consumer may be active)
+	void MediaEventQueue::Release()
+	{
+		delete this;
+	}
+
+	// Constructor: the ring allocates the event storage
+	MediaEventQueue::MediaEventQueue(int capacity)
+		: mRing(capacity)
+	{
+		mNextSequence.store(0, std::memory_order_relaxed);
+		mOverflowCount.store(0, std::memory_order_relaxed);
+		mCoalescedCount.store(0, std::memory_order_relaxed);
+
+		for (int i = 0; i < NumLatestSlots; i++)
+		{
+			mLatest[i].mSequence.store(0, std::memory_order_relaxed);
+			mLatest[i].mParam.store(0, std::memory_order_relaxed);
+			mLatest[i].mTimestamp.store(0, std::memory_order_relaxed);
+			mLatest[i].mTakenVersion = 0;
+		}
+	}
+
+	// Destructor
+	MediaEventQueue::~MediaEventQueue()
+	{
+	}
+}
@@ -1,14 +1,144 @@
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <cstdint>
 
-#include "VLCMediaPlayer.h"
+#include "MPSCRing.h"
+#include "SeqLock.h"
+
+// ---------------------------------------------------------------------------
+// Media Events
+//
+// Events reported by the player to Unity and a bounded multiple producer /
+// single consumer lock-free queue to pass them. Producers are libvlc's event,
+// video and audio threads (and the main thread for synchronous errors), the
+// consumer is Unity's main thread draining events once per frame.
+//
+// Events are held in an MPSCRing (see MPSCRing.h). When the queue is full new
+// events are dropped and counted rather than allocating.
+//
+// High frequency events (position, buffering progress) are coalesced: only
+// the latest value of each is kept in its own slot, so a stalled main thread
+// sees one current value rather than thousands of stale ones. Every event is
+// stamped with a sequence number and monotonic time when added, and the
+// consumer merges queued and coalesced events back into sequence order.
 
 namespace FPVR
 {
-	class MediaEvents
+	// Event structure, provides an event and associated context
+	typedef enum
+	{
+		NoEvent = 0,
+		OnError = 1,					// An was encountered with an asynchronous operation (param = int error code)
+		OnPrepared = 2,					// Media has been successfully parsed and is ready to play
+		OnVideoRenderingStart = 3,		// First frame of video is ready to display
+		OnPaused = 4,					// Media playback has been paused
+		OnPlaying = 5,					// Media playback has started
+		OnSeekComplete = 6,				// Seek to new position has completed
+		OnReachedEnd = 7,				// Media playback has reached end of media
+		OnBufferingStart = 8,			// Buffering has started
+		OnBufferingProgress = 9,		// New percentage complete for buffering (param = float percentage(
+		OnBufferingEnd = 10,			// Buffering has ended
+		OnPositionChanged = 11,			// Regular update on current position when playing
+		OnLooped = 12,					// Playback wrapped to the start in loop mode (param = loops completed)
+		OnItemChanged = 13				// Playback moved to the next playlist item (param = items switched to)
+	} eMPEvent;
+
+	typedef enum
+	{
+		NoError = 0,					// No error has occurred
+		IncompatibleState = 1,			// Call made when player in state where call not allowed
+		BadArgument = 2,				// Call made to function with error in argument(s)
+		InternalError = 3,				// Unexpected error occurred internally
+		MediaError = 4					// Problem occurred reading / processing media
+	} eMPError;
+
+	typedef struct
+	{
+		eMPEvent mMPEvent;
+		uint32_t mSequence;				// Order events were added in (wraps)
+		int64_t mParam;
+		int64_t mTimestamp;				// Monotonic time event was added (microseconds)
+	} MPEvent;
+
+	// How repeated events of a type are queued
+	typedef enum
 	{
-		void AddEvent(eMPEvents event);
-		eMPEvent GetEvent()
+		KeepAll = 0,					// Every event is queued (errors, state changes)
+		KeepLatest = 1					// Only the most recent event is kept
+	} eCoalescePolicy;
+
+	class MediaEventQueue
+	{
+	public:
+		static const int DefaultCapacity = 1024;
+
+		// Create a queue able to hold at least capacity events (rounded up to a power of two)
+		static MediaEventQueue* Create(int capacity = DefaultCapacity);
+
+		// Release the queue (no producer or consumer may be active)
+		void Release();
+
+		// Returns the coalescing policy for an event type
+		static eCoalescePolicy GetCoalescePolicy(eMPEvent mpEvent);
+
+		// Monotonic time used to stamp events (microseconds)
+		static int64_t Now();
+
+		// Producer: add an event, returns false (and counts an overflow) if the queue is full
+		bool Push(eMPEvent mpEvent, int64_t param);
+
+		// Consumer: remove the oldest event, returns false if the queue is empty
+		bool Pop(MPEvent* mpEvent);
+
+		// Consumer: remove up to maxEvents events in order, returns number removed
+		int PopMany(MPEvent* mpEvents, int maxEvents);
+
+		// Consumer: discard all pending events
+		void Clear();
+
+		// Consumer: approximate number of events waiting (coalesced events not included)
+		int Depth() const { return mRing.Depth(); }
+
+		// Number of events dropped because the queue was full
+		uint64_t OverflowCount() const { return mOverflowCount.load(std::memory_order_relaxed); }
+
+		// Number of events replaced by a later event of the same type before being read
+		uint64_t CoalescedCount() const { return mCoalescedCount.load(std::memory_order_relaxed); }
+
+	protected:
+		// Latest value of a coalesced event type. Written under a seqlock (producers serialised
+		// by its spin), fields are atomics so the consumer's optimistic read is race free.
+		typedef struct
+		{
+			SeqLock mLock;						// Version is 0 if never written
+			std::atomic<uint32_t> mSequence;	// Sequence of the latest event
+			std::atomic<int64_t> mParam;
+			std::atomic<int64_t> mTimestamp;
+			uint32_t mTakenVersion;				// Version last returned to the consumer (consumer only)
+		} sLatestSlot;
+
+		static const int NumLatestSlots = 2;	// OnPositionChanged, OnBufferingProgress
+
+		// Returns coalesced slot index for event type (or -1 if not coalesced)
+		static int GetLatestSlot(eMPEvent mpEvent);
+		static eMPEvent GetLatestSlotEvent(int slot);
+
+		// Consumer: read a coalesced slot, returns false if it holds no unread event
+		bool PeekLatest(int slot, MPEvent* mpEvent, uint32_t* version);
+
+		// Consumer: read queue head without removing it, returns false if the queue is empty
+		bool PeekQueue(MPEvent* mpEvent);
+
+		MPSCRing<MPEvent> mRing;						// Queued events
+
+		std::atomic<uint32_t> mNextSequence;			// Sequence given to next event added
+		std::atomic<uint64_t> mOverflowCount;			// Events dropped because the queue was full
+		std::atomic<uint64_t> mCoalescedCount;			// Events replaced before being read
+
+		sLatestSlot mLatest[NumLatestSlots];			// Coalesced events
+
+		MediaEventQueue(int capacity);
+		~MediaEventQueue();
 	};
 }
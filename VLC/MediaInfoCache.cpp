@@ -0,0 +1,384 @@
+// ---------------------------------------------------------------------------
+// Media Info Cache Class
+//
+// Persistent, memory mapped cache of probed media information
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <windows.h>
+
+#include "UnityPlugin.h"
+#include "PluginUtils.h"
+#include "MediaInfoCache.h"
+
+namespace FPVR
+{
+	MediaInfoCache* gMediaInfoCache = nullptr;
+
+	// 64 bit FNV-1a hash. Local paths are case insensitive and may use either separator
+	// so they are normalised before hashing.
+	static uint64_t HashString(const char* str, bool normalise)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (const char* c = str; *c != '\0'; c++)
+		{
+			int ch = (unsigned char)*c;
+			if (normalise)
+			{
+				ch = (ch == '\\' ? '/' : tolower(ch));
+			}
+			hash ^= (uint64_t)ch;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Converts a file: URL to a local path (file:///C:/a%20b.mp4 -> C:/a b.mp4,
+	// file://server/share/x.mp4 -> //server/share/x.mp4). Returns false if url isn't a file: URL
+	// or the path doesn't fit.
+	static bool FileURLToPath(const char* url, char* path, size_t size)
+	{
+		if (_strnicmp(url, "file:", 5) != 0)
+		{
+			return false;
+		}
+		const char* src = url + 5;
+		if (src[0] == '/' && src[1] == '/')
+		{
+			// Empty or localhost authority means a local path, otherwise keep it as a UNC host
+			if (src[2] == '/')
+			{
+				src += 3;
+			}
+			else if (_strnicmp(src + 2, "localhost/", 10) == 0)
+			{
+				src += 12;
+			}
+		}
+
+		size_t len = 0;
+		for (; *src != '\0'; src++)
+		{
+			int ch = (unsigned char)*src;
+			if (ch == '%' && isxdigit((unsigned char)src[1]) && isxdigit((unsigned char)src[2]))
+			{
+				char hex[3] = { src[1], src[2], '\0' };
+				ch = (int)strtol(hex, nullptr, 16);
+				src += 2;
+			}
+			if (len + 1 >= size)
+			{
+				return false;
+			}
+			path[len++] = (char)ch;
+		}
+		path[len] = '\0';
+		return (len > 0);
+	}
+
+	// Builds the key for a media path or URL
+	bool MediaInfoCache::MakeKey(const char* path, bool isURL, const char* etag, MediaInfoKey* key)
+	{
+		if (path == nullptr)
+		{
+			return false;
+		}
+
+		// file: URLs are validated like any other local file
+		char filePath[MAX_PATH];
+		if (isURL && FileURLToPath(path, filePath, sizeof(filePath)))
+		{
+			path = filePath;
+			isURL = false;
+		}
+
+		if (isURL)
+		{
+			// Without an ETag there is no way to tell the resource has changed, so it isn't cached
+			if (etag == nullptr || etag[0] == '\0')
+			{
+				return false;
+			}
+			key->mKey = HashString(path, false);
+			key->mSize = 0;
+			key->mValidator = HashString(etag, false);
+			return true;
+		}
+
+		WIN32_FILE_ATTRIBUTE_DATA attr;
+		if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attr))
+		{
+			return false;
+		}
+		key->mKey = HashString(path, true);
+		key->mSize = ((uint64_t)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+		key->mValidator = ((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+
+	// If there's a record matching key then copies it to info and returns true
+	bool MediaInfoCache::Lookup(const MediaInfoKey& key, MediaInfo* info)
+	{
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+
+		const MediaInfoRecord* record = nullptr;
+		std::unordered_map<uint64_t, MediaInfoRecord>::const_iterator it = mNewRecords.find(key.mKey);
+		if (it != mNewRecords.end())
+		{
+			record = &it->second;
+		}
+		else
+		{
+			record = FindMapped(key.mKey);
+		}
+
+		// Entry is stale if the file (or remote resource) has changed since it was probed
+		if (record != nullptr
+			&& record->mKey.mSize == key.mSize
+			&& record->mKey.mValidator == key.mValidator)
+		{
+			*info = record->mInfo;
+			return true;
+		}
+		return false;
+	}
+
+	// Adds or replaces the record for key
+	void MediaInfoCache::Store(const MediaInfoKey& key, const MediaInfo& info)
+	{
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		MediaInfoRecord& record = mNewRecords[key.mKey];
+		record.mKey = key;
+		record.mInfo = info;
+		record.mInfo.mReserved = 0;
+	}
+
+	// Monotonic time used to space saves (milliseconds)
+	static int64_t SaveClockNow()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Save if a batch of new records is waiting or records have waited SaveInterval
+	void MediaInfoCache::SaveIfDue()
+	{
+		int64_t now = SaveClockNow();
+		{
+			std::lock_guard<ProfiledMutex> lock(mMutex);
+			int64_t elapsed = now - mLastSaveTime;
+			if (mNewRecords.empty() || elapsed < MinSaveSpacing
+				|| (mNewRecords.size() < SaveBatchRecords && elapsed < SaveInterval))
+			{
+				return;
+			}
+			mLastSaveTime = now;
+		}
+		Save();
+	}
+
+	// Merge new records into the cache file. Records are written to a temporary file which
+	// then replaces the cache so a failed save never leaves a truncated cache behind.
+	bool MediaInfoCache::Save()
+	{
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+
+		if (mNewRecords.empty())
+		{
+			return true;
+		}
+
+		std::vector<MediaInfoRecord> records;
+		records.reserve(mNumRecords + mNewRecords.size());
+		for (uint32_t i = 0; i < mNumRecords; i++)
+		{
+			if (mNewRecords.find(mRecords[i].mKey.mKey) == mNewRecords.end())
+			{
+				records.push_back(mRecords[i]);
+			}
+		}
+		std::unordered_map<uint64_t, MediaInfoRecord>::const_iterator it;
+		for (it = mNewRecords.begin(); it != mNewRecords.end(); it++)
+		{
+			records.push_back(it->second);
+		}
+		std::sort(records.begin(), records.end(), [](const MediaInfoRecord& a, const MediaInfoRecord& b) { return a.mKey.mKey < b.mKey.mKey; });
+
+		MediaInfoCacheHeader header;
+		header.mMagic = kMagic;
+		header.mVersion = kVersion;
+		header.mNumRecords = (uint32_t)records.size();
+		header.mRecordSize = sizeof(MediaInfoRecord);
+
+		size_t tmpLen = strlen(mPath) + 5;
+		char* tmpPath = (char*)alloca(tmpLen);
+		_snprintf_s(tmpPath, tmpLen, _TRUNCATE, "%s.tmp", mPath);
+
+		FILE* fp;
+		if (fopen_s(&fp, tmpPath, "wb") != 0)
+		{
+			DebugLog("MediaInfoCache::Save() failed to open %s", tmpPath);
+			return false;
+		}
+		bool written = (fwrite(&header, sizeof(header), 1, fp) == 1
+			&& fwrite(records.data(), sizeof(MediaInfoRecord), records.size(), fp) == records.size());
+		fclose(fp);
+		if (!written)
+		{
+			DebugLog("MediaInfoCache::Save() failed to write %s", tmpPath);
+			return false;
+		}
+
+		// Mapping must be closed before the file can be replaced
+		Unmap();
+		bool replaced = (MoveFileExA(tmpPath, mPath, MOVEFILE_REPLACE_EXISTING) != FALSE);
+		if (replaced)
+		{
+			mNewRecords.clear();
+		}
+		Map();
+
+		DebugLog("MediaInfoCache::Save(%s) records=%d %s", mPath, (int)records.size(), (replaced ? "succeeded" : "failed"));
+		return replaced;
+	}
+
+	// Map the cache file into memory
+	bool MediaInfoCache::Map()
+	{
+		assert(mHeader == nullptr);
+
+		HANDLE file = CreateFileA(mPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(MediaInfoCacheHeader))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const MediaInfoCacheHeader* header = nullptr;
+		if (mapping != nullptr)
+		{
+			header = (const MediaInfoCacheHeader*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+
+		// Ignore files written by a different version or truncated files
+		if (header == nullptr
+			|| header->mMagic != kMagic
+			|| header->mVersion != kVersion
+			|| header->mRecordSize != sizeof(MediaInfoRecord)
+			|| (LONGLONG)(sizeof(MediaInfoCacheHeader) + (uint64_t)header->mNumRecords * sizeof(MediaInfoRecord)) > size.QuadPart)
+		{
+			DebugLog("MediaInfoCache::Map(%s) ignoring invalid cache file", mPath);
+			if (header != nullptr)
+			{
+				UnmapViewOfFile(header);
+			}
+			if (mapping != nullptr)
+			{
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+
+		mFile = file;
+		mMapping = mapping;
+		mHeader = header;
+		mRecords = (const MediaInfoRecord*)(header + 1);
+		mNumRecords = header->mNumRecords;
+		return true;
+	}
+
+	// Unmap the cache file
+	void MediaInfoCache::Unmap()
+	{
+		if (mHeader != nullptr)
+		{
+			UnmapViewOfFile(mHeader);
+			mHeader = nullptr;
+		}
+		if (mMapping != nullptr)
+		{
+			CloseHandle((HANDLE)mMapping);
+			mMapping = nullptr;
+		}
+		if (mFile != nullptr)
+		{
+			CloseHandle((HANDLE)mFile);
+			mFile = nullptr;
+		}
+		mRecords = nullptr;
+		mNumRecords = 0;
+	}
+
+	// Binary search of mapped records
+	const MediaInfoRecord* MediaInfoCache::FindMapped(uint64_t key) const
+	{
+		uint32_t lo = 0;
+		uint32_t hi = mNumRecords;
+		while (lo < hi)
+		{
+			uint32_t mid = lo + ((hi - lo) >> 1);
+			if (mRecords[mid].mKey.mKey < key)
+			{
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+		return (lo < mNumRecords && mRecords[lo].mKey.mKey == key ? &mRecords[lo] : nullptr);
+	}
+
+	// Open (or create on first save) the cache file at the specified path
+	MediaInfoCache* MediaInfoCache::Create(const char* path)
+	{
+		if (path == nullptr)
+		{
+			return nullptr;
+		}
+		MediaInfoCache* cache = new MediaInfoCache(path);
+		cache->Map();
+		DebugLog("MediaInfoCache::Create(%s) records=%d", path, cache->mNumRecords);
+		return cache;
+	}
+
+	// Save any new records and release the cache
+	void MediaInfoCache::Release()
+	{
+		Save();
+		delete this;
+	}
+
+	// Constructor: Initialise all member variables to a known state
+	MediaInfoCache::MediaInfoCache(const char* path) :
+		mMutex("MediaInfoCache::mMutex")
+	{
+		mPath = _strdup(path);
+		mFile = nullptr;
+		mMapping = nullptr;
+		mHeader = nullptr;
+		mRecords = nullptr;
+		mNumRecords = 0;
+		mLastSaveTime = SaveClockNow();
+	}
+
+	// Destructor: Unmap file and free path
+	MediaInfoCache::~MediaInfoCache()
+	{
+		Unmap();
+		free(mPath);
+	}
+}
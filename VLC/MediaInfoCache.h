@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "PluginUtils.h"
+#include "ProfiledMutex.h"
+
+// ---------------------------------------------------------------------------
+// Media Info Cache Class
+//
+// Persistent cache of probed media information (dimensions, duration, track
+// layout etc.) so that prepare does not have to wait for libvlc to parse the
+// container before the information is known. The cache file is memory mapped
+// when opened, records added while running are held in memory and merged
+// into the file in batches as they are added (see SaveIfDue) and when the
+// cache is released, so a crash loses at most the latest batch.
+//
+// File layout:
+//		MediaInfoCacheHeader
+//		MediaInfoRecord[mNumRecords]	(sorted by mKey for binary search)
+
+namespace FPVR
+{
+	class MediaInfoCache;
+
+	extern MediaInfoCache* gMediaInfoCache;
+
+	// Probed information about a single media item (blittable, shared with C#)
+	typedef struct
+	{
+		int64_t mDuration;			// Duration in ms (-1 if unknown)
+		int32_t mVideoWidth;		// Video width (-1 if unknown, 0 if no playable video)
+		int32_t mVideoHeight;		// Video height (-1 if unknown, 0 if no playable video)
+		int32_t mIsSeekable;		// Non-zero if media is seekable
+		int32_t mIsPausable;		// Non-zero if media is pausable
+		int32_t mNumVideoTracks;	// Number of video elementary streams
+		int32_t mNumAudioTracks;	// Number of audio elementary streams
+		int32_t mNumSubtitleTracks;	// Number of subtitle elementary streams
+		int32_t mAudioChannels;		// Number of channels in first audio track
+		int32_t mAudioRate;			// Sample rate of first audio track in Hz
+		int32_t mReserved;			// Padding, always 0
+	} MediaInfo;
+
+	// Identifies a media item and the version of it that was probed
+	typedef struct
+	{
+		uint64_t mKey;				// Hash of normalised path or URL
+		uint64_t mSize;				// File size in bytes (0 for URLs)
+		uint64_t mValidator;		// Last write time for files, hash of ETag for URLs
+	} MediaInfoKey;
+
+	// Record as stored in the cache file
+	typedef struct
+	{
+		MediaInfoKey mKey;
+		MediaInfo mInfo;
+	} MediaInfoRecord;
+
+	// Header at start of the cache file
+	typedef struct
+	{
+		uint32_t mMagic;			// kMagic
+		uint32_t mVersion;			// kVersion
+		uint32_t mNumRecords;		// Number of records following the header
+		uint32_t mRecordSize;		// sizeof(MediaInfoRecord) when written
+	} MediaInfoCacheHeader;
+
+	class MediaInfoCache
+	{
+	public:
+		static const uint32_t kMagic = 0x434d5046;	// 'FPMC'
+		static const uint32_t kVersion = 1;
+		static const size_t SaveBatchRecords = 16;		// New records that trigger a save
+		static const int64_t SaveInterval = 60000;		// Fewer new records are saved after this long (ms)
+		static const int64_t MinSaveSpacing = 5000;		// Saves are at least this far apart (ms)
+
+		// Open (or create on first save) the cache file at the specified path
+		static MediaInfoCache* Create(const char* path);
+
+		// Save any new records and release the cache
+		void Release();
+
+		// Builds the key for a media path or URL. For local files (including file: URLs) the
+		// size and last write time are read from the file system, for other URLs the ETag is
+		// the validator. Returns false if no key could be built (eg. file does not exist, or a
+		// URL has no ETag so a changed resource couldn't be detected).
+		static bool MakeKey(const char* path, bool isURL, const char* etag, MediaInfoKey* key);
+
+		// If there's a record matching key then copies it to info and returns true
+		bool Lookup(const MediaInfoKey& key, MediaInfo* info);
+
+		// Adds or replaces the record for key
+		void Store(const MediaInfoKey& key, const MediaInfo& info);
+
+		// Merge new records into the cache file
+		bool Save();
+
+		// Save if a batch of new records is waiting or records have waited SaveInterval. Called
+		// after Store, saves are spaced so a failing save isn't retried on every store.
+		void SaveIfDue();
+
+	protected:
+		char* mPath;								// Path of cache file
+
+		void* mFile;								// File handle for mapped file
+		void* mMapping;								// File mapping handle
+		const MediaInfoCacheHeader* mHeader;		// Start of mapped view (nullptr if not mapped)
+		const MediaInfoRecord* mRecords;			// Records in mapped view
+		uint32_t mNumRecords;						// Number of records in mapped view
+
+		ProfiledMutex mMutex;						// Protects new records and the mapping
+		std::unordered_map<uint64_t, MediaInfoRecord> mNewRecords;	// Records added since the file was mapped
+		int64_t mLastSaveTime;						// Monotonic time of the last save attempt or creation (ms)
+
+		// Map the cache file into memory, if it is missing or invalid the cache starts empty
+		bool Map();
+
+		// Unmap the cache file
+		void Unmap();
+
+		// Binary search of mapped records
+		const MediaInfoRecord* FindMapped(uint64_t key) const;
+
+		MediaInfoCache(const char* path);
+		~MediaInfoCache();
+	};
+}
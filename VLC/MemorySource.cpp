@@ -0,0 +1,170 @@
+// ---------------------------------------------------------------------------
+// Memory Source Class
+//
+// Media data read by libvlc straight from memory or a memory mapped pack file
+
+#include <cstring>
+
+#include <windows.h>
+
+#include <vlc/libvlc_version.h>
+
+#include "UnityPlugin.h"
+#include "PluginUtils.h"
+#include "MemorySource.h"
+
+// libvlc_media_new_callbacks was added in libvlc 3.0
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION(3, 0, 0, 0)
+#define FPVR_HAVE_MEDIA_CALLBACKS 1
+#else
+#define FPVR_HAVE_MEDIA_CALLBACKS 0
+#endif
+
+namespace FPVR
+{
+#if FPVR_HAVE_MEDIA_CALLBACKS
+	// Read position of one libvlc open of a source
+	typedef struct
+	{
+		const MemorySource* mSource;
+		uint64_t mPos;
+	} sMemoryCursor;
+
+	// libvlc is opening the media, give it a cursor at the start
+	static int MemoryOpenCB(void* opaque, void** datap, uint64_t* sizep)
+	{
+		MemorySource* source = (MemorySource*)opaque;
+		sMemoryCursor* cursor = new sMemoryCursor();
+		cursor->mSource = source;
+		cursor->mPos = 0;
+		*datap = cursor;
+		*sizep = source->Size();
+		return 0;
+	}
+
+	// Copy up to len bytes from the cursor to libvlc's buffer, 0 at end of media
+	static ssize_t MemoryReadCB(void* opaque, unsigned char* buf, size_t len)
+	{
+		sMemoryCursor* cursor = (sMemoryCursor*)opaque;
+		uint64_t remaining = cursor->mSource->Size() - cursor->mPos;
+		size_t count = (len < remaining ? len : (size_t)remaining);
+		memcpy(buf, cursor->mSource->Data() + cursor->mPos, count);
+		cursor->mPos += count;
+		return (ssize_t)count;
+	}
+
+	// Move the cursor, seeking past the end is an error
+	static int MemorySeekCB(void* opaque, uint64_t offset)
+	{
+		sMemoryCursor* cursor = (sMemoryCursor*)opaque;
+		if (offset > cursor->mSource->Size())
+		{
+			return -1;
+		}
+		cursor->mPos = offset;
+		return 0;
+	}
+
+	// libvlc has finished with this open
+	static void MemoryCloseCB(void* opaque)
+	{
+		delete (sMemoryCursor*)opaque;
+	}
+#endif
+
+	// True if the libvlc headers built against support memory sources
+	bool MemorySource::IsSupported()
+	{
+		return (FPVR_HAVE_MEDIA_CALLBACKS != 0);
+	}
+
+	// Create a media reading from this source
+	libvlc_media_t* MemorySource::CreateMedia(libvlc_instance_t* instance)
+	{
+#if FPVR_HAVE_MEDIA_CALLBACKS
+		return libvlc_media_new_callbacks(instance, MemoryOpenCB, MemoryReadCB, MemorySeekCB, MemoryCloseCB, this);
+#else
+		DebugLogS("MemorySource::CreateMedia() requires libvlc 3.0 or later");
+		return nullptr;
+#endif
+	}
+
+	// Wrap a caller owned memory region
+	MemorySource* MemorySource::Create(const void* data, uint64_t size)
+	{
+		if (data == nullptr || size == 0)
+		{
+			return nullptr;
+		}
+		MemorySource* source = new MemorySource();
+		source->mData = (const uint8_t*)data;
+		source->mSize = size;
+		return source;
+	}
+
+	// Map size bytes at offset of a pack file. The whole file is mapped (views must start on an
+	// allocation granularity boundary) and the region located within it.
+	MemorySource* MemorySource::CreateFromFile(const char* path, uint64_t offset, uint64_t size)
+	{
+		if (path == nullptr)
+		{
+			return nullptr;
+		}
+
+		MemorySource* source = new MemorySource();
+		source->mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER fileSize;
+		if (source->mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(source->mFile, &fileSize)
+			|| offset >= (uint64_t)fileSize.QuadPart || (size > 0 && offset + size > (uint64_t)fileSize.QuadPart))
+		{
+			DebugLog("MemorySource::CreateFromFile(%s) failed to open or region out of range", path);
+			source->Release();
+			return nullptr;
+		}
+
+		source->mMapping = CreateFileMappingA(source->mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		source->mView = (source->mMapping != nullptr ? MapViewOfFile(source->mMapping, FILE_MAP_READ, 0, 0, 0) : nullptr);
+		if (source->mView == nullptr)
+		{
+			DebugLog("MemorySource::CreateFromFile(%s) failed to map", path);
+			source->Release();
+			return nullptr;
+		}
+		source->mData = (const uint8_t*)source->mView + offset;
+		source->mSize = (size > 0 ? size : (uint64_t)fileSize.QuadPart - offset);
+		return source;
+	}
+
+	// Release the source
+	void MemorySource::Release()
+	{
+		delete this;
+	}
+
+	// Constructor
+	MemorySource::MemorySource()
+	{
+		mData = nullptr;
+		mSize = 0;
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = nullptr;
+		mView = nullptr;
+	}
+
+	// Destructor: close any mapping
+	MemorySource::~MemorySource()
+	{
+		if (mView != nullptr)
+		{
+			UnmapViewOfFile(mView);
+		}
+		if (mMapping != nullptr)
+		{
+			CloseHandle(mMapping);
+		}
+		if (mFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(mFile);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vlc/vlc.h>
+
+// ---------------------------------------------------------------------------
+// Memory Source Class
+//
+// Media data held in memory: either a region supplied by the caller (which
+// must stay valid until the player is reset) or a region of a pack file that
+// is memory mapped here. libvlc reads it through libvlc_media_new_callbacks,
+// each open gets its own cursor so libvlc may open the source more than once
+// (eg. when replaying from the start).
+//
+// libvlc_media_new_callbacks was added in libvlc 3.0. Built against older
+// headers the source can still be created but CreateMedia returns null.
+
+namespace FPVR
+{
+	class MemorySource
+	{
+	public:
+		// True if the libvlc headers built against support memory sources
+		static bool IsSupported();
+
+		// Wrap a caller owned memory region
+		static MemorySource* Create(const void* data, uint64_t size);
+
+		// Map size bytes at offset of a pack file (size 0 = to end of file)
+		static MemorySource* CreateFromFile(const char* path, uint64_t offset, uint64_t size);
+
+		// Release the source (any mapping is closed), libvlc must no longer be reading it
+		void Release();
+
+		// Create a media reading from this source (null if unsupported)
+		libvlc_media_t* CreateMedia(libvlc_instance_t* instance);
+
+		const uint8_t* Data() const { return mData; }
+		uint64_t Size() const { return mSize; }
+
+	protected:
+		const uint8_t* mData;		// Start of media data
+		uint64_t mSize;				// Bytes of media data
+
+		void* mFile;				// File handle if mapped from a pack file
+		void* mMapping;				// File mapping handle
+		const void* mView;			// Mapped view (mData is within it)
+
+		MemorySource();
+		~MemorySource();
+	};
+}
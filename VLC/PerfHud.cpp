@@ -0,0 +1,199 @@
+// ---------------------------------------------------------------------------
+// Performance HUD
+//
+// Bitmap font text drawn into 32 bit frames
+
+#include <cstring>
+
+#include "AudioUtils.h"
+#include "PerfHud.h"
+
+#if FPVR_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace FPVR
+{
+	static const int kGlyphWidth = 5;
+	static const int kGlyphHeight = 7;
+	static const int kCellWidth = (kGlyphWidth + 1) * HudScale;		// Glyph plus a column of spacing
+	static const int kCellHeight = (kGlyphHeight + 2) * HudScale;	// Glyph plus two rows of spacing
+	static const int kPadding = 2 * HudScale;						// Box border around the text
+	static const uint32_t kTextColour = 0xFFFFFFFF;
+
+	// 5x7 glyphs for ' ' to 'Z', one byte per row with the leftmost pixel in bit 4 (blank if not in the font)
+	static const char kFirstGlyph = ' ';
+	static const char kLastGlyph = 'Z';
+	static const uint8_t kGlyphs[kLastGlyph - kFirstGlyph + 1][kGlyphHeight] =
+	{
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// space
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// !
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// "
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// #
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// $
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },	// %
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// &
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// (
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// )
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// *
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// +
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ,
+		{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },	// -
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },	// .
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },	// /
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },	// 0
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },	// 1
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },	// 2
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },	// 3
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },	// 4
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },	// 5
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },	// 6
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },	// 7
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },	// 8
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },	// 9
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },	// :
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ;
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// <
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// =
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// >
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ?
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// @
+		{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },	// A
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },	// B
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },	// C
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },	// D
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },	// E
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },	// F
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },	// G
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },	// H
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },	// I
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },	// J
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },	// K
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },	// L
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },	// M
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },	// N
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },	// O
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },	// P
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },	// Q
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },	// R
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },	// S
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },	// T
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },	// U
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },	// V
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },	// W
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },	// X
+		{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },	// Y
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },	// Z
+	};
+
+	// Darken count pixels, halving each colour channel and making alpha opaque
+	static void DarkenRow(uint32_t* row, int count, uint32_t alphaMask)
+	{
+		const uint32_t colourMask = 0x7F7F7F7F & ~alphaMask;
+		int x = 0;
+
+#if FPVR_HAVE_SSE2
+		const __m128i vColour = _mm_set1_epi32((int)colourMask);
+		const __m128i vAlpha = _mm_set1_epi32((int)alphaMask);
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(row + x));
+			p = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 1), vColour), vAlpha);
+			_mm_storeu_si128((__m128i*)(row + x), p);
+		}
+#endif
+
+		// Remaining pixels (or all pixels without SSE)
+		for (; x < count; x++)
+		{
+			row[x] = ((row[x] >> 1) & colourMask) | alphaMask;
+		}
+	}
+
+	// Draw one character with its top left at x, y (the caller has clipped the cell to the frame)
+	static void DrawGlyph(uint8_t* pixels, int rowPitch, int x, int y, char c)
+	{
+		if (c >= 'a' && c <= 'z')
+		{
+			c = (char)(c - 'a' + 'A');
+		}
+		if (c < kFirstGlyph || c > kLastGlyph)
+		{
+			return;
+		}
+
+		const uint8_t* glyph = kGlyphs[c - kFirstGlyph];
+		for (int gy = 0; gy < kGlyphHeight; gy++)
+		{
+			uint8_t bits = glyph[gy];
+			if (bits == 0)
+			{
+				continue;
+			}
+			for (int sy = 0; sy < HudScale; sy++)
+			{
+				uint32_t* row = (uint32_t*)(pixels + (y + gy * HudScale + sy) * rowPitch) + x;
+				for (int gx = 0; gx < kGlyphWidth; gx++)
+				{
+					if (bits & (0x10 >> gx))
+					{
+						for (int sx = 0; sx < HudScale; sx++)
+						{
+							row[gx * HudScale + sx] = kTextColour;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Draw lines of text over a darkened box at the top left of a 32 bit frame
+	void DrawHud(void* pixels, int rowPitch, int width, int height, uint32_t alphaMask, const char* const* lines, int numLines)
+	{
+		numLines = (numLines < HudMaxLines ? numLines : HudMaxLines);
+		int maxChars = 0;
+		for (int i = 0; i < numLines; i++)
+		{
+			int len = (int)strlen(lines[i]);
+			maxChars = (len > maxChars ? len : maxChars);
+		}
+		maxChars = (maxChars < HudMaxChars ? maxChars : HudMaxChars);
+		if (pixels == nullptr || maxChars == 0)
+		{
+			return;
+		}
+
+		// Box sized to the text, clipped to the frame
+		int boxWidth = maxChars * kCellWidth + 2 * kPadding;
+		int boxHeight = numLines * kCellHeight + 2 * kPadding;
+		boxWidth = (boxWidth < width ? boxWidth : width);
+		boxHeight = (boxHeight < height ? boxHeight : height);
+
+		uint8_t* base = (uint8_t*)pixels;
+		for (int y = 0; y < boxHeight; y++)
+		{
+			DarkenRow((uint32_t*)(base + y * rowPitch), boxWidth, alphaMask);
+		}
+
+		// Only whole cells that fit in the box are drawn
+		for (int i = 0; i < numLines; i++)
+		{
+			int y = kPadding + i * kCellHeight;
+			if (y + kGlyphHeight * HudScale > boxHeight)
+			{
+				break;
+			}
+			const char* text = lines[i];
+			for (int n = 0; n < maxChars && text[n] != '\0'; n++)
+			{
+				int x = kPadding + n * kCellWidth;
+				if (x + kGlyphWidth * HudScale > boxWidth)
+				{
+					break;
+				}
+				DrawGlyph(base, rowPitch, x, y, text[n]);
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Performance HUD
+//
+// Lines of text burned into the top left corner of a 32 bit video frame on the
+// CPU, for reading playback statistics inside a headset. Text uses an embedded
+// 5x7 bitmap font (digits, upper case letters and a little punctuation, lower
+// case is drawn as upper case) scaled up by HudScale over a darkened box. Only
+// the box is touched: it is darkened with SSE2 four pixels at a time and the
+// glyph pixels are written directly, so drawing costs microseconds whatever
+// the frame size.
+
+namespace FPVR
+{
+	static const int HudScale = 2;				// Pixels per font pixel
+	static const int HudMaxLines = 8;
+	static const int HudMaxChars = 24;			// Characters drawn per line
+
+	// Draw numLines lines of text over a darkened box at the top left of a 32 bit frame
+	// (clipped to width x height). alphaMask has the bits of a pixel holding alpha, the box
+	// is made opaque.
+	extern void DrawHud(void* pixels, int rowPitch, int width, int height, uint32_t alphaMask, const char* const* lines, int numLines);
+}
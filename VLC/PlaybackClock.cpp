@@ -0,0 +1,167 @@
+// ---------------------------------------------------------------------------
+// Playback Clock Class
+//
+// Interpolated media position read lock free from any thread
+
+#include "PlaybackClock.h"
+
+namespace FPVR
+{
+	static const double kMinSlewFactor = 0.5;		// Slowest the clock slews, as a fraction of the playback rate
+
+	// Extrapolate from a consistent snapshot of the clock state. The slew rate applies from the
+	// anchor until slewEnd, the nominal rate after that.
+	int64_t PlaybackClock::Extrapolate(int64_t anchorMedia, int64_t anchorClock, int64_t slewEnd, double rate, double slewRate, bool paused, int64_t now)
+	{
+		if (paused || now <= anchorClock)
+		{
+			return anchorMedia;
+		}
+		if (now <= slewEnd)
+		{
+			return anchorMedia + (int64_t)((double)(now - anchorClock) * slewRate);
+		}
+		int64_t slewed = (slewEnd > anchorClock ? (int64_t)((double)(slewEnd - anchorClock) * slewRate) : 0);
+		int64_t start = (slewEnd > anchorClock ? slewEnd : anchorClock);
+		return anchorMedia + slewed + (int64_t)((double)(now - start) * rate);
+	}
+
+	// Lock free: media time (microseconds) at monotonic time now
+	int64_t PlaybackClock::GetTime(int64_t now) const
+	{
+		for (;;)
+		{
+			uint32_t version = mLock.ReadBegin();
+			int64_t anchorMedia = mAnchorMedia.load(std::memory_order_relaxed);
+			int64_t anchorClock = mAnchorClock.load(std::memory_order_relaxed);
+			int64_t slewEnd = mSlewEnd.load(std::memory_order_relaxed);
+			double rate = mRate.load(std::memory_order_relaxed);
+			double slewRate = mSlewRate.load(std::memory_order_relaxed);
+			bool paused = mPaused.load(std::memory_order_relaxed);
+			if (mLock.ReadValid(version))
+			{
+				return Extrapolate(anchorMedia, anchorClock, slewEnd, rate, slewRate, paused, now);
+			}
+		}
+	}
+
+	// Lock free: true if not extrapolating
+	bool PlaybackClock::IsPaused() const
+	{
+		return mPaused.load(std::memory_order_relaxed);
+	}
+
+	// Report media time observed at monotonic time now. The clock is re-anchored at its current
+	// extrapolated position and run at a rate that reaches the reported timeline after SlewPeriod,
+	// unless the error is large in which case it snaps. When the clock is ahead at low playback
+	// rates the slew rate is held at kMinSlewFactor * rate and the slew takes longer, so the
+	// clock never stops or runs backwards.
+	void PlaybackClock::Update(int64_t mediaTime, int64_t now)
+	{
+		mLock.BeginWrite();
+		double rate = mRate.load(std::memory_order_relaxed);
+		bool paused = mPaused.load(std::memory_order_relaxed);
+		int64_t current = Extrapolate(mAnchorMedia.load(std::memory_order_relaxed), mAnchorClock.load(std::memory_order_relaxed),
+			mSlewEnd.load(std::memory_order_relaxed), rate, mSlewRate.load(std::memory_order_relaxed), paused, now);
+		int64_t error = mediaTime - current;
+
+		if (paused || error > SnapThreshold || error < -SnapThreshold)
+		{
+			mAnchorMedia.store(mediaTime, std::memory_order_relaxed);
+			mSlewEnd.store(now, std::memory_order_relaxed);
+			mSlewRate.store(rate, std::memory_order_relaxed);
+		}
+		else
+		{
+			double slewRate = rate + (double)error / (double)SlewPeriod;
+			int64_t slewPeriod = SlewPeriod;
+			if (slewRate < rate * kMinSlewFactor)
+			{
+				slewRate = rate * kMinSlewFactor;
+				slewPeriod = (int64_t)((double)error / (slewRate - rate));
+			}
+			mAnchorMedia.store(current, std::memory_order_relaxed);
+			mSlewEnd.store(now + slewPeriod, std::memory_order_relaxed);
+			mSlewRate.store(slewRate, std::memory_order_relaxed);
+		}
+		mAnchorClock.store(now, std::memory_order_relaxed);
+		mLock.EndWrite();
+	}
+
+	// Jump to media time (eg. on seek) without any smoothing
+	void PlaybackClock::Set(int64_t mediaTime, int64_t now)
+	{
+		mLock.BeginWrite();
+		mAnchorMedia.store(mediaTime, std::memory_order_relaxed);
+		mAnchorClock.store(now, std::memory_order_relaxed);
+		mSlewEnd.store(now, std::memory_order_relaxed);
+		mSlewRate.store(mRate.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		mLock.EndWrite();
+	}
+
+	// Stop or restart extrapolation at monotonic time now (position is held while paused)
+	void PlaybackClock::SetPaused(bool paused, int64_t now)
+	{
+		mLock.BeginWrite();
+		int64_t current = Extrapolate(mAnchorMedia.load(std::memory_order_relaxed), mAnchorClock.load(std::memory_order_relaxed),
+			mSlewEnd.load(std::memory_order_relaxed), mRate.load(std::memory_order_relaxed), mSlewRate.load(std::memory_order_relaxed),
+			mPaused.load(std::memory_order_relaxed), now);
+		mAnchorMedia.store(current, std::memory_order_relaxed);
+		mAnchorClock.store(now, std::memory_order_relaxed);
+		mSlewEnd.store(now, std::memory_order_relaxed);
+		mSlewRate.store(mRate.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		mPaused.store(paused, std::memory_order_relaxed);
+		mLock.EndWrite();
+	}
+
+	// Set playback rate, position so far is kept
+	void PlaybackClock::SetRate(double rate, int64_t now)
+	{
+		mLock.BeginWrite();
+		int64_t current = Extrapolate(mAnchorMedia.load(std::memory_order_relaxed), mAnchorClock.load(std::memory_order_relaxed),
+			mSlewEnd.load(std::memory_order_relaxed), mRate.load(std::memory_order_relaxed), mSlewRate.load(std::memory_order_relaxed),
+			mPaused.load(std::memory_order_relaxed), now);
+		mAnchorMedia.store(current, std::memory_order_relaxed);
+		mAnchorClock.store(now, std::memory_order_relaxed);
+		mSlewEnd.store(now, std::memory_order_relaxed);
+		mRate.store(rate, std::memory_order_relaxed);
+		mSlewRate.store(rate, std::memory_order_relaxed);
+		mLock.EndWrite();
+	}
+
+	// Reset to position zero, paused, rate 1
+	void PlaybackClock::Reset()
+	{
+		mLock.BeginWrite();
+		mAnchorMedia.store(0, std::memory_order_relaxed);
+		mAnchorClock.store(0, std::memory_order_relaxed);
+		mSlewEnd.store(0, std::memory_order_relaxed);
+		mRate.store(1.0, std::memory_order_relaxed);
+		mSlewRate.store(1.0, std::memory_order_relaxed);
+		mPaused.store(true, std::memory_order_relaxed);
+		mLock.EndWrite();
+	}
+
+	// Create a clock at position zero, paused
+	PlaybackClock* PlaybackClock::Create()
+	{
+		return new PlaybackClock();
+	}
+
+	// Release the clock
+	void PlaybackClock::Release()
+	{
+		delete this;
+	}
+
+	// Constructor
+	PlaybackClock::PlaybackClock()
+	{
+		Reset();
+	}
+
+	// Destructor
+	PlaybackClock::~PlaybackClock()
+	{
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "SeqLock.h"
+
+// ---------------------------------------------------------------------------
+// Playback Clock Class
+//
+// Interpolated media position. libvlc only reports time when its input thread
+// ticks (TimeChanged events), so between reports the position is extrapolated
+// from the last report using the monotonic clock and playback rate.
+//
+// Small differences between a new report and the extrapolated position are
+// absorbed by briefly running the clock slightly fast or slow, so the position
+// is continuous and never steps backwards while playing. Large differences
+// (seeks, stalls) snap to the reported time.
+//
+// State is held under a seqlock: writers (libvlc's event thread and the main
+// thread) are serialised by a short spin, readers on any thread never block
+// and never enter libvlc.
+
+namespace FPVR
+{
+	class PlaybackClock
+	{
+	public:
+		// Create a clock at position zero, paused
+		static PlaybackClock* Create();
+
+		// Release the clock
+		void Release();
+
+		// Reset to position zero, paused, rate 1
+		void Reset();
+
+		// Report media time (microseconds) observed at monotonic time now
+		void Update(int64_t mediaTime, int64_t now);
+
+		// Jump to media time (eg. on seek) without any smoothing
+		void Set(int64_t mediaTime, int64_t now);
+
+		// Stop or restart extrapolation at monotonic time now
+		void SetPaused(bool paused, int64_t now);
+
+		// Set playback rate (1 = normal speed)
+		void SetRate(double rate, int64_t now);
+
+		// Lock free: media time (microseconds) at monotonic time now
+		int64_t GetTime(int64_t now) const;
+
+		// Lock free: true if not extrapolating
+		bool IsPaused() const;
+
+	protected:
+		static const int64_t SnapThreshold = 250000;		// Errors beyond this (us) snap rather than slew
+		static const int64_t SlewPeriod = 500000;			// Smaller errors are absorbed over roughly this long (us)
+
+		SeqLock mLock;							// Guards the state below for lock free readers
+
+		std::atomic<int64_t> mAnchorMedia;		// Media time at mAnchorClock
+		std::atomic<int64_t> mAnchorClock;		// Monotonic time of last anchor
+		std::atomic<int64_t> mSlewEnd;			// Monotonic time slewing stops
+		std::atomic<double> mRate;				// Nominal playback rate
+		std::atomic<double> mSlewRate;			// Rate used until mSlewEnd
+		std::atomic<bool> mPaused;				// True if not extrapolating
+
+		// Extrapolate from current state (caller holds a consistent snapshot)
+		static int64_t Extrapolate(int64_t anchorMedia, int64_t anchorClock, int64_t slewEnd, double rate, double slewRate, bool paused, int64_t now);
+
+		PlaybackClock();
+		~PlaybackClock();
+	};
+}
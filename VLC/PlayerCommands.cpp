@@ -0,0 +1,74 @@
+// ---------------------------------------------------------------------------
+// Player Commands
+//
+// Batched command execution for many players
+
+#include "PlayerCommands.h"
+#include "PlayerRegistry.h"
+#include "VLCMediaPlayer.h"
+
+namespace FPVR
+{
+	// Run commands in order, one result each
+	int SubmitCommands(const MPCommand* commands, int numCommands, MPCommandResult* results, MPEvent* events, int maxEvents)
+	{
+		int numEvents = 0;
+		for (int i = 0; i < numCommands; i++)
+		{
+			const MPCommand& cmd = commands[i];
+			MPCommandResult& result = results[i];
+			result.mPlayer = cmd.mPlayer;
+			result.mStatus = CmdOk;
+			result.mPosition = 0;
+			result.mDuration = -1;
+			result.mFirstEvent = numEvents;
+			result.mNumEvents = 0;
+
+			VLCMediaPlayer* player = FindPlayer(cmd.mPlayer);
+			if (player == nullptr)
+			{
+				result.mStatus = CmdNoPlayer;
+				continue;
+			}
+
+			switch (cmd.mCommand)
+			{
+			case CmdPlay:
+				player->Play();
+				break;
+
+			case CmdPause:
+				player->Pause();
+				break;
+
+			case CmdSeek:
+				player->SeekTo(cmd.mParam, (cmd.mArg == SeekFast ? SeekFast : SeekAccurate));
+				break;
+
+			case CmdSetVolume:
+				player->SetVolume(cmd.mValue);
+				break;
+
+			case CmdSetRate:
+				player->SetRate(cmd.mValue);
+				break;
+
+			case CmdPoll:
+				player->Update();
+				result.mPosition = player->PeekPositionUs() / 1000;
+				result.mDuration = player->GetDuration();
+				if (events != nullptr && numEvents < maxEvents)
+				{
+					result.mNumEvents = player->GetMediaEvents(events + numEvents, maxEvents - numEvents);
+					numEvents += result.mNumEvents;
+				}
+				break;
+
+			default:
+				result.mStatus = CmdUnknown;
+				break;
+			}
+		}
+		return numEvents;
+	}
+}
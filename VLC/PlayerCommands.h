@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include "MediaEvents.h"
+
+// ---------------------------------------------------------------------------
+// Player Commands
+//
+// Batched control of many players: one call carries a packed array of
+// commands for any players and returns every result (and the events drained
+// by polls) in caller-provided arrays, so a scene costs one interop transition
+// per frame however many players it has. Commands run in order on the main
+// thread. Structures are plain data so they can be passed straight from
+// managed arrays.
+
+namespace FPVR
+{
+	// Command to run against a player
+	typedef enum
+	{
+		CmdPlay = 0,					// Play
+		CmdPause = 1,					// Pause
+		CmdSeek = 2,					// Seek to mParam milliseconds (mArg = eSeekMode)
+		CmdSetVolume = 3,				// Set volume to mValue (1 = unchanged)
+		CmdSetRate = 4,					// Set playback rate to mValue (1 = normal speed)
+		CmdPoll = 5						// Per frame update, then report position and retrieve events
+	} eMPCommand;
+
+	// Result of a command
+	typedef enum
+	{
+		CmdOk = 0,
+		CmdNoPlayer = 1,				// Handle doesn't refer to a player
+		CmdUnknown = 2					// Unknown command
+	} eMPCommandStatus;
+
+	typedef struct
+	{
+		int32_t mPlayer;				// Player handle (0 = default player)
+		int32_t mCommand;				// eMPCommand
+		int64_t mParam;					// Seek position (milliseconds)
+		float mValue;					// Volume or rate
+		int32_t mArg;					// Seek mode
+	} MPCommand;
+
+	typedef struct
+	{
+		int32_t mPlayer;				// Player handle the command was for
+		int32_t mStatus;				// eMPCommandStatus
+		int64_t mPosition;				// Poll: playback position (milliseconds, 0 until prepared)
+		int64_t mDuration;				// Poll: duration (milliseconds, -1 if unknown)
+		int32_t mFirstEvent;			// Poll: index of the first event retrieved in the events array
+		int32_t mNumEvents;				// Poll: number of events retrieved
+	} MPCommandResult;
+
+	// Run numCommands commands in order writing one result each. Events retrieved by polls are
+	// appended to events (up to maxEvents in total, the rest stay queued for the next poll).
+	// Returns the number of events retrieved.
+	extern int SubmitCommands(const MPCommand* commands, int numCommands, MPCommandResult* results, MPEvent* events, int maxEvents);
+}
@@ -0,0 +1,232 @@
+// ---------------------------------------------------------------------------
+// Player Registry
+//
+// Handles for additional players
+
+#include <mutex>
+
+#include "PlayerRegistry.h"
+#include "Trace.h"
+#include "VLCMediaPlayer.h"
+#include "VideoFrameManager.h"
+
+namespace FPVR
+{
+	static const int kSlotBits = 8;				// Handle bits holding slot + 1 (MaxPlayers must fit)
+	static const int kSlotMask = (1 << kSlotBits) - 1;
+	static const int kGenerationMask = 0xFFFF;	// Keeps handles below the render event flags
+	static const int kHandleMask = RenderEventPlayer - 1;
+
+	static std::mutex gPlayersMutex;			// Held by the render thread and while adding or removing
+	static std::mutex gAudioMutexes[MaxPlayers];	// Per slot, held while draining audio and while the slot changes
+	static VLCMediaPlayer* gPlayers[MaxPlayers];
+	static int gGenerations[MaxPlayers];		// Incremented each time a slot is freed
+
+	// Register a player in the first free slot
+	int AddPlayer(VLCMediaPlayer* player)
+	{
+		std::lock_guard<std::mutex> lock(gPlayersMutex);
+		for (int slot = 0; slot < MaxPlayers; slot++)
+		{
+			if (gPlayers[slot] == nullptr)
+			{
+				std::lock_guard<std::mutex> audioLock(gAudioMutexes[slot]);
+				gPlayers[slot] = player;
+				return ((gGenerations[slot] & kGenerationMask) << kSlotBits) | (slot + 1);
+			}
+		}
+		return -1;
+	}
+
+	// Slot a handle refers to, -1 if it isn't a live player's handle (main thread, or with the
+	// registry mutex or the slot's audio mutex held)
+	static int HandleSlot(int handle)
+	{
+		int slot = (handle & kSlotMask) - 1;
+		if (handle <= 0 || slot < 0 || slot >= MaxPlayers || gPlayers[slot] == nullptr
+			|| (handle >> kSlotBits) != (gGenerations[slot] & kGenerationMask))
+		{
+			return -1;
+		}
+		return slot;
+	}
+
+	// Unregister a player, once this returns neither the render thread nor the audio thread
+	// sees it (a drain in progress is waited for)
+	VLCMediaPlayer* RemovePlayer(int handle)
+	{
+		std::lock_guard<std::mutex> lock(gPlayersMutex);
+		int slot = HandleSlot(handle);
+		if (slot < 0)
+		{
+			return nullptr;
+		}
+		std::lock_guard<std::mutex> audioLock(gAudioMutexes[slot]);
+		VLCMediaPlayer* player = gPlayers[slot];
+		gPlayers[slot] = nullptr;
+		gGenerations[slot]++;
+		return player;
+	}
+
+	// Returns the player for handle. Only the main thread changes the registry so lookups
+	// there need no lock.
+	VLCMediaPlayer* FindPlayer(int handle)
+	{
+		if (handle == 0)
+		{
+			return gVLCMediaPlayer;
+		}
+		int slot = HandleSlot(handle);
+		return (slot >= 0 ? gPlayers[slot] : nullptr);
+	}
+
+	// Slot whose audio mutex guards handle, -1 if handle can't refer to a registered player
+	static int AudioSlot(int handle)
+	{
+		int slot = (handle & kSlotMask) - 1;
+		return (handle <= 0 || slot < 0 || slot >= MaxPlayers ? -1 : slot);
+	}
+
+	// Retrieve interleaved audio for one channel from a player. Only the player's slot is locked,
+	// so the audio thread never waits for the render thread or for other players' drains.
+	int PlayerRetrieveAudioData(int handle, int channel, float* buffer, int maxLength, int* floatsCopied)
+	{
+		if (handle == 0)
+		{
+			if (gVLCMediaPlayer != nullptr)
+			{
+				return gVLCMediaPlayer->RetrieveAudioData(channel, buffer, maxLength, floatsCopied);
+			}
+			*floatsCopied = 0;
+			return 0;
+		}
+
+		int slot = AudioSlot(handle);
+		if (slot >= 0)
+		{
+			std::lock_guard<std::mutex> lock(gAudioMutexes[slot]);
+			if (HandleSlot(handle) == slot)
+			{
+				return gPlayers[slot]->RetrieveAudioData(channel, buffer, maxLength, floatsCopied);
+			}
+		}
+		*floatsCopied = 0;
+		return 0;
+	}
+
+	// Retrieve planar audio for every channel from a player (locking as PlayerRetrieveAudioData)
+	int PlayerRetrieveAudioDataPlanar(int handle, float* buffer, int numChannels, int maxFrames, int* framesCopied)
+	{
+		if (handle == 0)
+		{
+			if (gVLCMediaPlayer != nullptr)
+			{
+				return gVLCMediaPlayer->RetrieveAudioDataPlanar(buffer, numChannels, maxFrames, framesCopied);
+			}
+			*framesCopied = 0;
+			return 0;
+		}
+
+		int slot = AudioSlot(handle);
+		if (slot >= 0)
+		{
+			std::lock_guard<std::mutex> lock(gAudioMutexes[slot]);
+			if (HandleSlot(handle) == slot)
+			{
+				return gPlayers[slot]->RetrieveAudioDataPlanar(buffer, numChannels, maxFrames, framesCopied);
+			}
+		}
+		*framesCopied = 0;
+		return 0;
+	}
+
+	// Render every registered player
+	void RenderPlayers()
+	{
+		std::lock_guard<std::mutex> lock(gPlayersMutex);
+		for (int slot = 0; slot < MaxPlayers; slot++)
+		{
+			if (gPlayers[slot] != nullptr)
+			{
+				gPlayers[slot]->Render();
+			}
+		}
+	}
+
+	// Render one player. The handle is checked under the registry mutex as the main thread may
+	// be adding or removing players.
+	void RenderPlayer(int handle)
+	{
+		if (handle == 0)
+		{
+			if (gVLCMediaPlayer != nullptr)
+			{
+				gVLCMediaPlayer->Render();
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(gPlayersMutex);
+		int slot = HandleSlot(handle);
+		if (slot >= 0)
+		{
+			gPlayers[slot]->Render();
+		}
+	}
+
+	// Batched render: find the players with work to do, recycle all their frames, then do all
+	// their uploads back to back
+	void RenderDirtyPlayers()
+	{
+		FPVR_TRACE_SCOPE("RenderDirtyPlayers");
+		VideoFrameManager* managers[MaxPlayers + 1];
+		int64_t presentTimes[MaxPlayers + 1];
+		int numDirty = 0;
+
+		std::lock_guard<std::mutex> lock(gPlayersMutex);
+		for (int slot = -1; slot < MaxPlayers; slot++)
+		{
+			VLCMediaPlayer* player = (slot < 0 ? gVLCMediaPlayer : gPlayers[slot]);
+			if (player != nullptr)
+			{
+				int64_t presentTime = player->BeginRender();
+				if (player->FrameManager()->NeedsRender(presentTime))
+				{
+					managers[numDirty] = player->FrameManager();
+					presentTimes[numDirty] = presentTime;
+					numDirty++;
+				}
+			}
+		}
+
+		for (int i = 0; i < numDirty; i++)
+		{
+			managers[i]->RecycleFrames();
+		}
+		for (int i = 0; i < numDirty; i++)
+		{
+			managers[i]->UploadFrame(presentTimes[i]);
+		}
+	}
+
+	// Route a render event
+	void RenderEvent(int eventID)
+	{
+		if (eventID == RenderEventDirty)
+		{
+			RenderDirtyPlayers();
+		}
+		else if ((eventID & ~kHandleMask) == RenderEventPlayer)
+		{
+			RenderPlayer(eventID & kHandleMask);
+		}
+		else
+		{
+			if (gVLCMediaPlayer != nullptr)
+			{
+				gVLCMediaPlayer->Render();
+			}
+			RenderPlayers();
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Player Registry
+//
+// Handles for players beyond the default one. Handle 0 always refers to the
+// default player (gVLCMediaPlayer, created by VLCMP_Initialise), other players
+// are created with VLCMP_CreatePlayer and given a handle made from their slot
+// and a generation count, so a stale handle to a released player never finds
+// the player that reused its slot.
+//
+// Players are added, removed and looked up on the main thread. The render
+// thread walks the registered players under the registry mutex. The audio
+// thread only takes a per slot mutex around looking up and draining the one
+// player it wants, so it never waits for renders or other players. Adding and
+// removing take both, so a player is never released while it is being
+// rendered or drained.
+//
+// Render event IDs (passed to GL.IssuePluginEvent with VLCMP_GetRenderEventFunc)
+// say which players a render event updates:
+//
+//		RenderEventPlayer | handle	render just that player (handle 0 = default player)
+//		RenderEventDirty			render every player with work to do, uploads batched
+//		anything else				render every player (what older scripts passing 1 get)
+//
+// Handles always fit below the flag bits. A batched render skips players with no
+// frame due and nothing to recycle, then recycles frames for every player left in
+// one pass and copies their frames to their textures back to back, so the driver
+// sees the uploads together rather than interleaved with pool bookkeeping.
+
+namespace FPVR
+{
+	class VLCMediaPlayer;
+
+	static const int MaxPlayers = 64;			// Players besides the default player
+
+	static const int RenderEventPlayer = 0x10000000;	// Render event for one player (or'd with its handle)
+	static const int RenderEventDirty = 0x20000000;		// Render event for all players with work to do
+
+	// Register a player, returns its handle (-1 if there is no free slot)
+	extern int AddPlayer(VLCMediaPlayer* player);
+
+	// Unregister a player, returns it for the caller to release (nullptr if handle is not valid)
+	extern VLCMediaPlayer* RemovePlayer(int handle);
+
+	// Returns the player for handle (0 = default player), nullptr if handle is not valid
+	extern VLCMediaPlayer* FindPlayer(int handle);
+
+	// Audio thread: retrieve a player's audio (see VLCMediaPlayer::RetrieveAudioData and
+	// RetrieveAudioDataPlanar) under its slot's audio mutex so the player can't be released
+	// meanwhile. Nothing is copied if handle is not valid.
+	extern int PlayerRetrieveAudioData(int handle, int channel, float* buffer, int maxLength, int* floatsCopied);
+	extern int PlayerRetrieveAudioDataPlanar(int handle, float* buffer, int numChannels, int maxFrames, int* framesCopied);
+
+	// Render thread: render every registered player
+	extern void RenderPlayers();
+
+	// Render thread: render one player (0 = default player), ignored if handle is not valid
+	extern void RenderPlayer(int handle);
+
+	// Render thread: batched render of the default and registered players that have a frame due
+	// or frames to recycle
+	extern void RenderDirtyPlayers();
+
+	// Render thread: route a render event to the players its ID selects
+	extern void RenderEvent(int eventID);
+}
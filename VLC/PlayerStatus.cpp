@@ -0,0 +1,79 @@
+// ---------------------------------------------------------------------------
+// Player Status Block
+//
+// Seqlock published player status
+
+#include <atomic>
+#include <cstring>
+
+#include "PlayerStatus.h"
+
+namespace FPVR
+{
+	// The block is shared with readers that aren't C++ (managed code reading through a
+	// pointer), so the version is accessed as volatile with explicit fences rather than
+	// making the block hold atomics.
+	static uint32_t LoadVersion(const MPStatus* status)
+	{
+		return *(const volatile uint32_t*)&status->mVersion;
+	}
+
+	static void StoreVersion(MPStatus* status, uint32_t version)
+	{
+		*(volatile uint32_t*)&status->mVersion = version;
+	}
+
+	// Allocate a zeroed status block
+	MPStatus* CreateStatusBlock()
+	{
+		MPStatus* status = new MPStatus;
+		memset(status, 0, sizeof(MPStatus));
+		status->mSize = sizeof(MPStatus);
+		status->mVideoWidth = -1;
+		status->mVideoHeight = -1;
+		status->mDuration = -1;
+		return status;
+	}
+
+	// Release a status block (no reader may still be using it)
+	void ReleaseStatusBlock(MPStatus* status)
+	{
+		delete status;
+	}
+
+	// Writer: make the version odd before any field is written. A release fence only orders
+	// earlier accesses before later stores' publication, not the odd store before the field
+	// stores that follow it, so a full fence is needed here.
+	void BeginStatusWrite(MPStatus* status)
+	{
+		StoreVersion(status, LoadVersion(status) + 1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	// Writer: make the version even again once every field is written
+	void EndStatusWrite(MPStatus* status)
+	{
+		std::atomic_thread_fence(std::memory_order_release);
+		StoreVersion(status, LoadVersion(status) + 1);
+	}
+
+	// Reader: copy the block, retrying while it is being written or if it changed during the copy
+	void ReadStatus(const MPStatus* status, MPStatus* copy)
+	{
+		for (;;)
+		{
+			uint32_t version = LoadVersion(status);
+			if ((version & 1) == 0)
+			{
+				std::atomic_thread_fence(std::memory_order_acquire);
+				memcpy(copy, status, sizeof(MPStatus));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (LoadVersion(status) == version)
+				{
+					copy->mVersion = version;
+					return;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Player Status Block
+//
+// Each player publishes its status into a block of native memory that never
+// moves while the player exists, so managed code can keep a pointer to it and
+// read state, position, dimensions and counters every frame without an
+// interop call. The block is written once per Update (or poll command) by the
+// main thread under a seqlock:
+//
+//		writer:	mVersion = odd, write fields, mVersion = next even
+//		reader:	v = mVersion (retry if odd), copy fields, retry if mVersion != v
+//
+// Readers on any thread never block the writer. Managed readers should use
+// Volatile.Read for mVersion and copy the block between the two reads.
+
+namespace FPVR
+{
+	typedef struct
+	{
+		uint32_t mVersion;				// Seqlock version, odd while being written
+		uint32_t mSize;					// sizeof(MPStatus), for checking the managed layout
+		int32_t mState;					// libvlc_state_t (0 if there is no media)
+		int32_t mBufferingPercent;		// Last buffering progress reported
+		int32_t mVideoWidth;			// -1 if unknown, 0 if no playable video
+		int32_t mVideoHeight;
+		int32_t mIsSeekable;			// 1 or 0
+		int32_t mIsPausable;
+		int32_t mNumAudioChannels;
+		int32_t mIsLooping;
+		int64_t mPosition;				// Playback position (milliseconds)
+		int64_t mPositionUs;			// Playback position (microseconds)
+		int64_t mDuration;				// Milliseconds, -1 if unknown
+		int64_t mPublishTime;			// Monotonic time the block was written (microseconds)
+		int64_t mPublishCount;			// Times the block has been written
+		int64_t mFramesDecoded;
+		int64_t mFramesDisplayed;
+		int64_t mFramesDropped;
+		int64_t mFramesRepeated;
+		int64_t mEventOverflows;
+		int64_t mAudioUnderruns;
+	} MPStatus;
+
+	// Allocate a zeroed status block (released with ReleaseStatusBlock)
+	extern MPStatus* CreateStatusBlock();
+	extern void ReleaseStatusBlock(MPStatus* status);
+
+	// Writer (one thread only): mark the block as being written / written
+	extern void BeginStatusWrite(MPStatus* status);
+	extern void EndStatusWrite(MPStatus* status);
+
+	// Reader: copy a consistent snapshot of the block
+	extern void ReadStatus(const MPStatus* status, MPStatus* copy);
+}
@@ -1,7 +1,12 @@
 #include "UnityPlugin.h"
 #include "PluginUtils.h"
 #include "VLCMediaPlayer.h"	// TODO: Move the debug log stuff to the plugin utilities and make it global
+#include "LogWriter.h"
+#include "ProfiledMutex.h"
+#include "Trace.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 
 #include <stdarg.h>
@@ -11,47 +16,262 @@ namespace FPVR
 	// Callback function
 	typedef void(*DebugCallback)(const char* debugStr);
 
-	// Pointer to user function to handle debug strings
+	// Pointer to user function to handle debug strings (main thread only)
 	static DebugCallback gDebugCallback = nullptr;
 
-	// Simple/single string debug log
-	void DebugLogS(const char* str)
+	// Debug log writer, created by the first line logged
+	static std::atomic<LogWriter*> gLogWriter(nullptr);
+
+	// Set by DebugLogShutdown, lines logged after it (eg. by libvlc threads still running at unload)
+	// are dropped rather than starting a writer thread that would outlive the plugin
+	static std::atomic<bool> gLogShutdown(false);
+
+	// Returns the log writer, creating it if needed (only the thread that wins the race keeps its
+	// writer). Returns nullptr once logging has been shut down.
+	static LogWriter* GetLogWriter()
 	{
-		FILE* fp;
-		if(fopen_s(&fp, "LibVLCWrapper.log.txt", "a+") == 0)
+		if (gLogShutdown.load(std::memory_order_acquire))
 		{
-			fprintf(fp, "%s\n", str);
-			fclose(fp);
+			return nullptr;
 		}
-/*		if (gDebugCallback != nullptr)
+		LogWriter* writer = gLogWriter.load(std::memory_order_acquire);
+		if (writer == nullptr)
 		{
-			gDebugCallback(str);
+			LogWriter* created = LogWriter::Create("LibVLCWrapper.log.txt");
+			if (gLogWriter.compare_exchange_strong(writer, created, std::memory_order_acq_rel))
+			{
+				writer = created;
+
+				// Shut down while this writer was being created, take it back out if shutdown hasn't.
+				// Another thread may have picked it up meanwhile so it is stopped, never deleted.
+				if (gLogShutdown.load(std::memory_order_acquire))
+				{
+					if (gLogWriter.compare_exchange_strong(created, nullptr, std::memory_order_acq_rel))
+					{
+						writer->Stop();
+					}
+					return nullptr;
+				}
+			}
+			else
+			{
+				created->Release();
+			}
+		}
+		return writer;
+	}
+
+	// Runtime log threshold
+	std::atomic<int> gDebugLogLevel((int)LogInfo);
+
+	// Set the runtime threshold
+	void SetDebugLogLevel(int level)
+	{
+		gDebugLogLevel.store((level < LogDebug ? LogDebug : (level > LogNone ? LogNone : level)), std::memory_order_relaxed);
+	}
+
+	// Log at a level without checking it, formats straight into the log writer's ring
+	void DebugLogAt(eLogLevel level, const char* str, ...)
+	{
+		va_list args;
+		LogWriter* writer = GetLogWriter();
+		if (writer != nullptr)
+		{
+			va_start(args, str);
+			writer->WriteV(str, args);
+			va_end(args);
+		}
+	}
+
+	// VAArg version of DebugLogAt
+	void DebugLogAtV(eLogLevel level, const char* str, va_list args)
+	{
+		LogWriter* writer = GetLogWriter();
+		if (writer != nullptr)
+		{
+			writer->WriteV(str, args);
+		}
+	}
+
+	// Simple/single string debug log. Lines are queued for the log writer thread, the caller
+	// never does file I/O.
+	void DebugLogS(const char* str)
+	{
+		LogWriter* writer = (DebugLogEnabled(LogInfo) ? GetLogWriter() : nullptr);
+		if (writer != nullptr)
+		{
+			writer->Write(str);
 		}
-*/
 	}
 
 	// Printf style debug log
 	void DebugLog(const char* str, ...)
+	{
+		LogWriter* writer = (DebugLogEnabled(LogInfo) ? GetLogWriter() : nullptr);
+		if (writer != nullptr)
+		{
+			va_list args;
+			va_start(args, str);
+			writer->WriteV(str, args);
+			va_end(args);
+		}
+	}
+
+	// VAArg debug log function, formats straight into the log writer's ring
+	void DebugLogV(const char* str, va_list args)
+	{
+		LogWriter* writer = (DebugLogEnabled(LogInfo) ? GetLogWriter() : nullptr);
+		if (writer != nullptr)
+		{
+			writer->WriteV(str, args);
+		}
+	}
+
+	// Format into a scratch buffer (benchmark of the formatting a written log call does)
+	static int FormatForBenchmark(char* buf, size_t size, const char* str, ...)
 	{
 		va_list args;
 		va_start(args, str);
-		DebugLogV(str, args);
+		int len = _vsnprintf_s(buf, size, _TRUNCATE, str, args);
 		va_end(args);
+		return len;
 	}
 
-	// VAArg debug log function
-	void DebugLogV(const char* str, va_list args)
+	// Measure the cost of a filtered log call and of formatting a typical message. The filtered
+	// call uses a level just below the current threshold so nothing is written.
+	void BenchmarkDebugLog(int iterations, double* filteredNs, double* formatNs)
 	{
-		int len = _vscprintf(str, args);
-		char* buf = (char*)alloca(len + 1);
-		vsprintf_s(buf, len + 1, str, args);
-		DebugLogS(buf);
+		static const char* kFormat = "VLCMediaPlayer::OnMediaEvent(%s) - new_time=%I64d, w=%d, h=%d";
+		eLogLevel filtered = (eLogLevel)(gDebugLogLevel.load(std::memory_order_relaxed) - 1);
+		char buf[LogWriter::MaxLineLength + 1];
+		volatile int sink = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			FPVR_LOG(filtered, kFormat, "MediaPlayerTimeChanged", (int64_t)i * 40, 1920, 1080);
+		}
+		std::chrono::steady_clock::time_point mid = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			sink += FormatForBenchmark(buf, sizeof(buf), kFormat, "MediaPlayerTimeChanged", (int64_t)i * 40, 1920, 1080);
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		double count = (double)(iterations > 0 ? iterations : 1);
+		*filteredNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() / count;
+		*formatNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() / count;
 	}
 
-	// Set debug callback
+	// Pass log lines written since the last call to the debug callback as one newline separated
+	// string. Called once per frame from Unity's main thread (VLCMP_Update) so managed code is
+	// only entered from that thread and once per batch.
+	void DebugLogDeliver()
+	{
+		static std::string sBatch;
+		DebugCallback callback = gDebugCallback;
+		LogWriter* writer = gLogWriter.load(std::memory_order_acquire);
+		if (callback != nullptr && writer != nullptr && writer->TakeForwarded(sBatch))
+		{
+			callback(sBatch.c_str());
+		}
+	}
+
+	// Write all queued log lines and stop the log writer thread (on plugin unload). Lines logged
+	// after this are dropped. The writer itself is deliberately never deleted: a libvlc thread
+	// may have loaded the pointer just before shutdown and still be writing a line into its ring.
+	void DebugLogShutdown()
+	{
+		gLogShutdown.store(true, std::memory_order_release);
+		LogWriter* writer = gLogWriter.exchange(nullptr);
+		if (writer != nullptr)
+		{
+			writer->Stop();
+		}
+	}
+
+	// Returns number of debug log lines dropped because the log writer fell behind
+	uint64_t DebugLogDroppedCount()
+	{
+		LogWriter* writer = gLogWriter.load(std::memory_order_acquire);
+		return (writer != nullptr ? writer->DroppedCount() : 0);
+	}
+
+	// Returns true if path refers to a URL. Currently assumes local if not one of our recognised schemes
+	bool PathIsURL(const char* path)
+	{
+		return (_strnicmp(path, "http:", 5) == 0
+			|| _strnicmp(path, "https:", 6) == 0
+			|| _strnicmp(path, "rtsp:", 5) == 0
+			|| _strnicmp(path, "rtmp:", 5) == 0
+			|| _strnicmp(path, "file:", 5) == 0);
+	}
+
+	// Set debug callback. Log lines are delivered in batches from VLCMP_Update (or
+	// FPVR_DeliverDebugLog), never from libvlc's threads.
 	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_SetDebugCallback(DebugCallback cb)
 	{
 		gDebugCallback = cb;
+		LogWriter* writer = GetLogWriter();
+		if (writer != nullptr)
+		{
+			writer->SetForwarding(cb != nullptr);
+		}
+	}
+
+	// Deliver pending log lines to the debug callback (for use without a media player)
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_DeliverDebugLog()
+	{
+		DebugLogDeliver();
+	}
+
+	// Set the debug log threshold (0 = debug, 1 = info, 2 = warning, 3 = error, 4 = none)
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_SetDebugLogLevel(int level)
+	{
+		SetDebugLogLevel(level);
+	}
+
+	// Measure nanoseconds per filtered log call and per message formatted
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_BenchmarkDebugLog(int iterations, double* filteredNs, double* formatNs)
+	{
+		BenchmarkDebugLog(iterations, filteredNs, formatNs);
+	}
+
+	// Get number of debug log lines dropped because the log writer fell behind
+	extern "C" uint64_t UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_GetDebugLogDropped()
+	{
+		return DebugLogDroppedCount();
+	}
+
+	// Start or stop recording trace spans (only available in builds with FPVR_ENABLE_TRACE)
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_SetTraceEnabled(bool enable)
+	{
+		SetTraceEnabled(enable);
+	}
+
+	// Discard all recorded trace spans
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_ClearTrace()
+	{
+		ClearTrace();
+	}
+
+	// Write recorded trace spans to path as Chrome trace event JSON
+	extern "C" bool UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_DumpTrace(const char* path)
+	{
+		return DumpTrace(path);
+	}
+
+	// Copy lock site statistics for up to maxSites sites, returns number copied (0 unless built
+	// with FPVR_PROFILE_LOCKS)
+	extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_GetLockStats(LockStats* stats, int maxSites)
+	{
+		return (stats != nullptr && maxSites > 0 ? GetLockStats(stats, maxSites) : 0);
+	}
+
+	// Zero lock site statistics
+	extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FPVR_ResetLockStats()
+	{
+		ResetLockStats();
 	}
 
 #if SUPPORT_D3D9
@@ -112,11 +332,11 @@ namespace FPVR
 		{
 			if (gTexFmtInfo[i].mUnityTexFmt == format)
 			{
-				DebugLog("GetTexFmtFromUnity(unityTexFormat=%d) returns %d", format, i);
+				FPVR_LOG_DEBUG("GetTexFmtFromUnity(unityTexFormat=%d) returns %d", format, i);
 				return (eTexFmt)i;
 			}
 		}
-		DebugLog("GetTexFmtFromUnity(unityTexFormat=%d) returns %d", format, TEXFMT_UNKNOWN);
+		FPVR_LOG_WARNING("GetTexFmtFromUnity(unityTexFormat=%d) returns %d", format, TEXFMT_UNKNOWN);
 		return TEXFMT_UNKNOWN;
 	}
 
@@ -165,9 +385,13 @@ namespace FPVR
 
 	void DumpTextureDesc(void* texture, int unityFmt)
 	{
+		if (!FPVR_LOG_ENABLED(LogDebug))
+		{
+			return;
+		}
 		int width, height, format;
 		GetTextureDesc(texture, width, height, format);
-		DebugLog("Texture: %08x Width=%d Height=%d Format=%d UnityFmt:%d", texture, width, height, format, unityFmt);
+		FPVR_LOG_DEBUG("Texture: %08x Width=%d Height=%d Format=%d UnityFmt:%d", texture, width, height, format, unityFmt);
 	}
 
 	void GetTextureDesc(void* texture, int& width, int& height, int& format)
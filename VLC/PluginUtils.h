@@ -1,16 +1,73 @@
 #pragma once
 
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
 #include <list>
 
 // --------------------------------------------------------------------------
 // Helper utilities
 
+// Lowest log level compiled in (FPVR::eLogLevel value), calls to the FPVR_LOG macros below it
+// compile to nothing
+#ifndef FPVR_LOG_MIN_LEVEL
+#define FPVR_LOG_MIN_LEVEL 0
+#endif
+
+// Leveled logging. The level is checked against the compile time minimum and the runtime
+// threshold before the arguments are evaluated, so a filtered call costs one relaxed load.
+#define FPVR_LOG_ENABLED(level)	((int)(level) >= FPVR_LOG_MIN_LEVEL && FPVR::DebugLogEnabled(level))
+#define FPVR_LOG(level, ...)	do { if (FPVR_LOG_ENABLED(level)) { FPVR::DebugLogAt((level), __VA_ARGS__); } } while (0)
+#define FPVR_LOG_DEBUG(...)		FPVR_LOG(FPVR::LogDebug, __VA_ARGS__)
+#define FPVR_LOG_INFO(...)		FPVR_LOG(FPVR::LogInfo, __VA_ARGS__)
+#define FPVR_LOG_WARNING(...)	FPVR_LOG(FPVR::LogWarning, __VA_ARGS__)
+#define FPVR_LOG_ERROR(...)		FPVR_LOG(FPVR::LogError, __VA_ARGS__)
+
 namespace FPVR
 {
+	// Log levels (DebugLog / DebugLogS log at LogInfo)
+	typedef enum
+	{
+		LogDebug = 0,					// Per frame / per event detail
+		LogInfo = 1,					// Lifecycle and configuration
+		LogWarning = 2,
+		LogError = 3,
+		LogNone = 4						// Runtime threshold only, disables logging
+	} eLogLevel;
+
+	// Runtime threshold, messages below it are not formatted
+	extern std::atomic<int> gDebugLogLevel;
+
+	// Returns true if messages at level are currently written
+	inline bool DebugLogEnabled(eLogLevel level) { return (int)level >= gDebugLogLevel.load(std::memory_order_relaxed); }
+
+	// Set the runtime threshold (eLogLevel, LogNone disables logging)
+	extern void SetDebugLogLevel(int level);
+
+	// Log at a level without checking it (use the FPVR_LOG macros)
+	extern void DebugLogAt(eLogLevel level, const char* str, ...);
+	extern void DebugLogAtV(eLogLevel level, const char* str, va_list args);
+
 	extern void DebugLog(const char* str, ...);
 	extern void DebugLogS(const char* str);
 	extern void DebugLogV(const char* str, va_list args);
 
+	// Measure the cost of a log call filtered out at runtime and of formatting a typical message
+	// (what a call that is written pays before queuing). Returns nanoseconds per call.
+	extern void BenchmarkDebugLog(int iterations, double* filteredNs, double* formatNs);
+
+	// Pass log lines written since the last call to the debug callback in one call (main thread)
+	extern void DebugLogDeliver();
+
+	// Write all queued log lines and stop the log writer thread (on plugin unload)
+	extern void DebugLogShutdown();
+
+	// Returns number of debug log lines dropped because the log writer fell behind
+	extern uint64_t DebugLogDroppedCount();
+
+	// Returns true if path refers to a URL. Currently assumes local if not one of our recognised schemes
+	extern bool PathIsURL(const char* path);
+
 	// Enumeration of supported texture formats
 	typedef enum
 	{
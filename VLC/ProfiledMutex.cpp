@@ -0,0 +1,185 @@
+// ---------------------------------------------------------------------------
+// Profiled Mutex Class
+//
+// Per lock site wait / hold statistics
+
+#include <atomic>
+#include <cstring>
+
+#include "ProfiledMutex.h"
+#include "LatencyHistogram.h"
+#include "PluginUtils.h"
+#include "Trace.h"
+
+namespace FPVR
+{
+#if FPVR_PROFILE_LOCKS
+	struct sLockSite
+	{
+		char mName[sizeof(((LockStats*)nullptr)->mName)];
+		std::atomic<int64_t> mAcquisitions;
+		std::atomic<int64_t> mContentions;
+		std::atomic<int64_t> mMaxWait;
+		std::atomic<int64_t> mMaxHold;
+		LatencyHistogram mWait;
+		LatencyHistogram mHold;
+	};
+
+	// Sites are added as mutexes are created and never removed, so a site pointer stays valid
+	// and the statistics outlive the objects that own the mutexes
+	static std::mutex gLockSitesMutex;
+	static sLockSite gLockSites[MaxLockSites];
+	static std::atomic<int> gNumLockSites(0);
+
+	// Raise max to value if it is larger
+	static void UpdateMax(std::atomic<int64_t>& max, int64_t value)
+	{
+		int64_t current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// Find the site called name, adding it if it is new
+	static sLockSite* FindLockSite(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(gLockSitesMutex);
+		int count = gNumLockSites.load(std::memory_order_relaxed);
+		for (int i = 0; i < count; i++)
+		{
+			if (strcmp(gLockSites[i].mName, name) == 0)
+			{
+				return &gLockSites[i];
+			}
+		}
+		if (count == MaxLockSites)
+		{
+			DebugLog("ProfiledMutex: no free lock site for %s", name);
+			return nullptr;
+		}
+
+		sLockSite* site = &gLockSites[count];
+		strncpy_s(site->mName, sizeof(site->mName), name, _TRUNCATE);
+		site->mAcquisitions = 0;
+		site->mContentions = 0;
+		site->mMaxWait = 0;
+		site->mMaxHold = 0;
+		site->mWait.Reset();
+		site->mHold.Reset();
+		gNumLockSites.store(count + 1, std::memory_order_release);
+		return site;
+	}
+
+	// Constructor: attach to the statistics for site
+	ProfiledMutex::ProfiledMutex(const char* site)
+	{
+		mSite = FindLockSite(site);
+		mAcquiredAt = 0;
+	}
+
+	// Record an acquisition, a contended wait is also traced
+	void ProfiledMutex::Acquired(int64_t now, int64_t wait, bool contended)
+	{
+		mAcquiredAt = now;
+		if (mSite != nullptr)
+		{
+			mSite->mAcquisitions.fetch_add(1, std::memory_order_relaxed);
+			mSite->mWait.Add(wait);
+			if (contended)
+			{
+				mSite->mContentions.fetch_add(1, std::memory_order_relaxed);
+				UpdateMax(mSite->mMaxWait, wait);
+#if FPVR_ENABLE_TRACE
+				if (gTraceEnabled.load(std::memory_order_relaxed))
+				{
+					TraceRecord(mSite->mName, (now - wait) * 1000, now * 1000);
+				}
+#endif
+			}
+		}
+	}
+
+	// Lock, timing the wait only if the mutex is already held
+	void ProfiledMutex::lock()
+	{
+		if (mMutex.try_lock())
+		{
+			Acquired(LatencyHistogram::Now(), 0, false);
+		}
+		else
+		{
+			int64_t start = LatencyHistogram::Now();
+			mMutex.lock();
+			int64_t now = LatencyHistogram::Now();
+			Acquired(now, now - start, true);
+		}
+	}
+
+	// Lock if the mutex is free (a failed attempt isn't counted)
+	bool ProfiledMutex::try_lock()
+	{
+		if (!mMutex.try_lock())
+		{
+			return false;
+		}
+		Acquired(LatencyHistogram::Now(), 0, false);
+		return true;
+	}
+
+	// Unlock, recording how long the lock was held
+	void ProfiledMutex::unlock()
+	{
+		if (mSite != nullptr)
+		{
+			int64_t hold = LatencyHistogram::Now() - mAcquiredAt;
+			mSite->mHold.Add(hold);
+			UpdateMax(mSite->mMaxHold, hold);
+		}
+		mMutex.unlock();
+	}
+#endif
+
+	// Copy statistics for up to maxSites sites
+	int GetLockStats(LockStats* stats, int maxSites)
+	{
+#if FPVR_PROFILE_LOCKS
+		int count = gNumLockSites.load(std::memory_order_acquire);
+		count = (count < maxSites ? count : maxSites);
+		for (int i = 0; i < count; i++)
+		{
+			sLockSite& site = gLockSites[i];
+			LockStats& out = stats[i];
+			memcpy(out.mName, site.mName, sizeof(out.mName));
+			out.mAcquisitions = site.mAcquisitions.load(std::memory_order_relaxed);
+			out.mContentions = site.mContentions.load(std::memory_order_relaxed);
+			out.mWaitP50 = site.mWait.Percentile(0.5);
+			out.mWaitP99 = site.mWait.Percentile(0.99);
+			out.mMaxWait = site.mMaxWait.load(std::memory_order_relaxed);
+			out.mHoldP50 = site.mHold.Percentile(0.5);
+			out.mHoldP99 = site.mHold.Percentile(0.99);
+			out.mMaxHold = site.mMaxHold.load(std::memory_order_relaxed);
+		}
+		return count;
+#else
+		return 0;
+#endif
+	}
+
+	// Zero statistics for all sites
+	void ResetLockStats()
+	{
+#if FPVR_PROFILE_LOCKS
+		int count = gNumLockSites.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++)
+		{
+			sLockSite& site = gLockSites[i];
+			site.mAcquisitions = 0;
+			site.mContentions = 0;
+			site.mMaxWait = 0;
+			site.mMaxHold = 0;
+			site.mWait.Reset();
+			site.mHold.Reset();
+		}
+#endif
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// ---------------------------------------------------------------------------
+// Profiled Mutex Class
+//
+// Mutex that can record how it is used, for finding the locks worth making
+// lock free. Each mutex is named after its lock site; every mutex with the same
+// name shares one set of statistics: acquisitions, contended acquisitions (the
+// lock was already held), wait and hold time histograms and the longest wait
+// and hold. Contended waits are also recorded as trace spans named after the
+// site when tracing is enabled.
+//
+// Profiling is compiled in only if FPVR_PROFILE_LOCKS is defined to 1,
+// otherwise ProfiledMutex is a plain std::mutex and GetLockStats reports no
+// sites. Either way it works with std::lock_guard / std::unique_lock.
+
+#ifndef FPVR_PROFILE_LOCKS
+#define FPVR_PROFILE_LOCKS 0
+#endif
+
+namespace FPVR
+{
+	// Statistics for one lock site (times in microseconds)
+	typedef struct
+	{
+		char mName[48];					// Site name
+		int64_t mAcquisitions;			// Times locked
+		int64_t mContentions;			// Times the lock was already held when locked
+		int64_t mWaitP50;				// Time waiting to lock
+		int64_t mWaitP99;
+		int64_t mMaxWait;
+		int64_t mHoldP50;				// Time held
+		int64_t mHoldP99;
+		int64_t mMaxHold;
+	} LockStats;
+
+	// Lock sites that can be tracked (mutexes named after further sites aren't profiled)
+	static const int MaxLockSites = 32;
+
+	// Copy statistics for up to maxSites sites, returns number copied (0 if profiling is compiled out)
+	extern int GetLockStats(LockStats* stats, int maxSites);
+
+	// Zero statistics for all sites
+	extern void ResetLockStats();
+
+#if FPVR_PROFILE_LOCKS
+	struct sLockSite;
+
+	class ProfiledMutex
+	{
+	public:
+		// Create a mutex counted against site (a string literal naming the lock)
+		ProfiledMutex(const char* site);
+
+		void lock();
+		bool try_lock();
+		void unlock();
+
+	protected:
+		std::mutex mMutex;
+		sLockSite* mSite;				// Statistics (nullptr if there were no free sites)
+		int64_t mAcquiredAt;			// Time the current holder locked (written by the holder only)
+
+		// Record an acquisition after waiting wait microseconds
+		void Acquired(int64_t now, int64_t wait, bool contended);
+	};
+#else
+	// Plain mutex, the site name is ignored
+	class ProfiledMutex : public std::mutex
+	{
+	public:
+		ProfiledMutex(const char* site) {}
+	};
+#endif
+}
@@ -0,0 +1,182 @@
+// ---------------------------------------------------------------------------
+// Scrub Decoder Class
+//
+// Secondary libvlc player parked at a position while scrubbing
+
+#include <cstring>
+
+#include "PluginUtils.h"
+#include "ScrubDecoder.h"
+
+namespace FPVR
+{
+	// libvlc is about to decode a frame, hold frame memory while it is written
+	void* ScrubDecoder::LockCB(void* opaque, void** planes)
+	{
+		ScrubDecoder* sd = (ScrubDecoder*)opaque;
+		sd->mDecodeMutex.lock();
+		*planes = sd->mPixels;
+		return nullptr;
+	}
+
+	// Frame has been written
+	void ScrubDecoder::UnlockCB(void* opaque, void* picture, void* const* planes)
+	{
+		ScrubDecoder* sd = (ScrubDecoder*)opaque;
+		sd->mDecodeMutex.unlock();
+	}
+
+	// Frame is ready to be shown, capture the first one after Park along with the time libvlc
+	// has reported for it. The decoder is paused from the main thread.
+	void ScrubDecoder::DisplayCB(void* opaque, void* picture)
+	{
+		ScrubDecoder* sd = (ScrubDecoder*)opaque;
+		std::lock_guard<std::mutex> decode(sd->mDecodeMutex);
+		std::lock_guard<ProfiledMutex> lock(sd->mMutex);
+		if (sd->mCaptureWanted)
+		{
+			memcpy(sd->mCaptured, sd->mPixels, sd->mSize);
+			sd->mCapturedTime = sd->mReportedTime;
+			sd->mCaptureWanted = false;
+			sd->mFrameArrived = true;
+		}
+	}
+
+	// libvlc's media time (libvlc 2.2 gives the video callbacks no timestamps, and asking the
+	// player for its time from a video callback can deadlock against stop)
+	void ScrubDecoder::TimeChangedCB(const libvlc_event_t* ev, void* data)
+	{
+		ScrubDecoder* sd = (ScrubDecoder*)data;
+		sd->mReportedTime = ev->u.media_player_time_changed.new_time;
+	}
+
+	// Start decoding the frame at pos (milliseconds). As libvlc 2.2 doesn't display new frames
+	// while paused the seek is issued paused, so no frame from the old position can be captured,
+	// then the decoder runs until the first frame arrives.
+	void ScrubDecoder::Park(int64_t pos)
+	{
+		if (!mPaused)
+		{
+			libvlc_media_player_set_pause(mPlayer, 1);
+		}
+		mFrameArrived = false;
+		mHaveFrame = false;
+		mParkPosition = pos;
+		mReportedTime = -1;
+		{
+			std::lock_guard<ProfiledMutex> lock(mMutex);
+			mCaptureWanted = true;
+			mCapturedTime = -1;
+		}
+		libvlc_media_player_set_time(mPlayer, pos);
+		libvlc_media_player_set_pause(mPlayer, 0);
+		mPaused = false;
+	}
+
+	// Pause once the parked frame has been captured. The frame time is the one libvlc reported
+	// when the frame was displayed, or failing that the first report after it (the frame is the
+	// keyframe at or before the park position if libvlc hasn't reported by now).
+	void ScrubDecoder::Update()
+	{
+		if (!mPaused && mFrameArrived)
+		{
+			libvlc_media_player_set_pause(mPlayer, 1);
+			mPaused = true;
+
+			std::lock_guard<ProfiledMutex> lock(mMutex);
+			int64_t reported = mReportedTime;
+			mFrameTime = (mCapturedTime >= 0 ? mCapturedTime : (reported >= 0 ? reported : mParkPosition));
+			mHaveFrame = true;
+		}
+	}
+
+	// Copy held frame to dst, returns false if there is no frame. Only the captured copy is read
+	// so this never waits for the decoder.
+	bool ScrubDecoder::CopyFrame(void* dst, int size)
+	{
+		if (!mHaveFrame || size > mSize)
+		{
+			return false;
+		}
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		memcpy(dst, mCaptured, size);
+		return true;
+	}
+
+	// Create a decoder for the media using the same frame format as the main player
+	ScrubDecoder* ScrubDecoder::Create(libvlc_instance_t* instance, const char* path, bool isURL, const char* fourCC, int width, int height, int stride)
+	{
+		ScrubDecoder* sd = new ScrubDecoder();
+		sd->mSize = stride * height;
+		sd->mPixels = new unsigned char[sd->mSize];
+		sd->mCaptured = new unsigned char[sd->mSize];
+		memset(sd->mPixels, 0, sd->mSize);
+		memset(sd->mCaptured, 0, sd->mSize);
+
+		sd->mMedia = (isURL ? libvlc_media_new_location(instance, path) : libvlc_media_new_path(instance, path));
+		if (sd->mMedia != nullptr)
+		{
+			// Only keyframes are decoded (skip-frame 3 discards all others), seeks land on them and
+			// the input opens paused so nothing is decoded until the first Park
+			libvlc_media_add_option(sd->mMedia, ":no-audio");
+			libvlc_media_add_option(sd->mMedia, ":input-fast-seek");
+			libvlc_media_add_option(sd->mMedia, ":avcodec-skip-frame=3");
+			libvlc_media_add_option(sd->mMedia, ":start-paused");
+			sd->mPlayer = libvlc_media_player_new_from_media(sd->mMedia);
+		}
+		if (sd->mPlayer == nullptr)
+		{
+			DebugLogS("ScrubDecoder::Create() failed");
+			sd->Release();
+			return nullptr;
+		}
+
+		libvlc_event_attach(libvlc_media_player_event_manager(sd->mPlayer), libvlc_MediaPlayerTimeChanged, TimeChangedCB, sd);
+		libvlc_video_set_callbacks(sd->mPlayer, LockCB, UnlockCB, DisplayCB, sd);
+		libvlc_video_set_format(sd->mPlayer, fourCC, width, height, stride);
+		libvlc_media_player_play(sd->mPlayer);
+		sd->mPaused = true;
+		return sd;
+	}
+
+	// Release the decoder (stops its libvlc player)
+	void ScrubDecoder::Release()
+	{
+		delete this;
+	}
+
+	// Constructor
+	ScrubDecoder::ScrubDecoder() :
+		mMutex("ScrubDecoder::mMutex")
+	{
+		mMedia = nullptr;
+		mPlayer = nullptr;
+		mPixels = nullptr;
+		mCaptured = nullptr;
+		mSize = 0;
+		mCaptureWanted = false;
+		mCapturedTime = -1;
+		mReportedTime = -1;
+		mFrameArrived = false;
+		mHaveFrame = false;
+		mPaused = false;
+		mParkPosition = -1;
+		mFrameTime = -1;
+	}
+
+	// Destructor: stopping the player waits for its callbacks to finish
+	ScrubDecoder::~ScrubDecoder()
+	{
+		if (mPlayer != nullptr)
+		{
+			libvlc_media_player_stop(mPlayer);
+			libvlc_media_player_release(mPlayer);
+		}
+		if (mMedia != nullptr)
+		{
+			libvlc_media_release(mMedia);
+		}
+		delete[] mPixels;
+		delete[] mCaptured;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <vlc/vlc.h>
+
+#include "ProfiledMutex.h"
+
+// ---------------------------------------------------------------------------
+// Scrub Decoder Class
+//
+// Secondary libvlc player used while scrubbing. It is parked at a position:
+// it seeks there (decoding keyframes only, no audio), captures the first frame
+// displayed into a separate buffer and pauses. It opens paused so it decodes
+// nothing until first parked. When the scrub cursor moves near a parked
+// position the main player can show that frame straight away while its own
+// seek is still in flight. The decoder never writes the captured copy, so
+// reading it never waits for a decode.
+//
+// Video callbacks run on the decoder's libvlc thread, everything else must be
+// called from the main thread.
+
+namespace FPVR
+{
+	class ScrubDecoder
+	{
+	public:
+		// Create a decoder for the media using the same frame format as the main player
+		static ScrubDecoder* Create(libvlc_instance_t* instance, const char* path, bool isURL, const char* fourCC, int width, int height, int stride);
+
+		// Release the decoder (stops its libvlc player)
+		void Release();
+
+		// Start decoding the frame at pos (milliseconds)
+		void Park(int64_t pos);
+
+		// Pause once the parked frame has been captured (call once per frame)
+		void Update();
+
+		// True if the frame for the last Park is held
+		bool HasFrame() const { return mHaveFrame; }
+
+		// Position last parked at (milliseconds)
+		int64_t ParkPosition() const { return mParkPosition; }
+
+		// Media time of held frame (milliseconds, the keyframe at or before the park position)
+		int64_t FrameTime() const { return mFrameTime; }
+
+		// Copy held frame to dst (stride * height bytes), returns false if there is no frame
+		bool CopyFrame(void* dst, int size);
+
+	protected:
+		libvlc_media_t* mMedia;					// Media opened paused with fast seek, keyframes only and no audio
+		libvlc_media_player_t* mPlayer;			// Decoder player
+
+		unsigned char* mPixels;					// Frame memory written by libvlc
+		unsigned char* mCaptured;				// First frame displayed after Park
+		int mSize;								// Bytes in mPixels and mCaptured
+
+		std::mutex mDecodeMutex;				// Held while libvlc writes mPixels (libvlc threads only)
+		ProfiledMutex mMutex;					// Protects mCaptured, mCaptureWanted and mCapturedTime
+		bool mCaptureWanted;					// True if the next frame displayed should be captured
+		int64_t mCapturedTime;					// Media time reported when the frame was captured (-1 if none yet)
+		std::atomic<int64_t> mReportedTime;		// Last time libvlc reported since Park (milliseconds, -1 if none)
+		std::atomic<bool> mFrameArrived;		// Set by display callback once the frame is captured
+		bool mHaveFrame;						// True once frame arrived and decoder paused
+		bool mPaused;							// True if decoder is paused
+		int64_t mParkPosition;					// Last park position
+		int64_t mFrameTime;						// Media time of held frame
+
+		static void* LockCB(void* opaque, void** planes);
+		static void UnlockCB(void* opaque, void* picture, void* const* planes);
+		static void DisplayCB(void* opaque, void* picture);
+		static void TimeChangedCB(const libvlc_event_t* ev, void* data);
+
+		ScrubDecoder();
+		~ScrubDecoder();
+	};
+}
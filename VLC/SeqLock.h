@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Sequence Lock
+//
+// Writer side spin and version counter for state read optimistically from any
+// thread, used by the playback clock and the coalesced media event slots.
+//
+// Writers are serialised by a short spin and make the version odd while they
+// update the protected fields, readers copy the fields and retry if a write was
+// in progress or completed meanwhile. The protected fields must themselves be
+// atomics (accessed relaxed) so the optimistic copy is race free, the fences
+// here order them against the version.
+
+namespace FPVR
+{
+	class SeqLock
+	{
+	public:
+		SeqLock()
+		{
+			mWriting.store(false, std::memory_order_relaxed);
+			mVersion.store(0, std::memory_order_relaxed);
+		}
+
+		// Writer: take the writer spin then make the version odd
+		void BeginWrite()
+		{
+			while (mWriting.exchange(true, std::memory_order_acquire))
+			{
+			}
+			mVersion.store(mVersion.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		// Writer: make the version even again and release the writer spin
+		void EndWrite()
+		{
+			mVersion.store(mVersion.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			mWriting.store(false, std::memory_order_release);
+		}
+
+		// Reader: version to pass to ReadValid once the fields have been copied. Every write
+		// advances it by two, so it also tells a reader how many writes happened (0 if none).
+		uint32_t ReadBegin() const
+		{
+			return mVersion.load(std::memory_order_acquire);
+		}
+
+		// Reader: true if the fields copied since ReadBegin returned version are consistent
+		bool ReadValid(uint32_t version) const
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return ((version & 1) == 0 && version == mVersion.load(std::memory_order_relaxed));
+		}
+
+	protected:
+		std::atomic<bool> mWriting;				// Held by the writer updating the fields
+		std::atomic<uint32_t> mVersion;			// Odd while being written
+
+		SeqLock(const SeqLock&) = delete;
+		SeqLock& operator=(const SeqLock&) = delete;
+	};
+}
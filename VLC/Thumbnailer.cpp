@@ -0,0 +1,432 @@
+// ---------------------------------------------------------------------------
+// Thumbnailer Class
+//
+// Background thumbnail and sprite sheet extraction over a worker pool
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <windows.h>
+
+#include "UnityPlugin.h"
+#include "PluginUtils.h"
+#include "MediaInfoCache.h"
+#include "Thumbnailer.h"
+
+namespace FPVR
+{
+	Thumbnailer* gThumbnailer = nullptr;
+
+	// Frame capture shared with a worker's libvlc video callbacks
+	typedef struct
+	{
+		std::mutex mMutex;					// Held while libvlc writes mPixels
+		std::condition_variable mArrived;	// Signalled when a frame has been captured
+		std::vector<uint8_t> mPixels;		// Frame being decoded
+		std::vector<uint8_t> mCaptured;		// First frame displayed after mWanted was set
+		bool mWanted;						// True if the next displayed frame should be captured
+	} sCapture;
+
+	static void* CaptureLockCB(void* opaque, void** planes)
+	{
+		sCapture* cap = (sCapture*)opaque;
+		cap->mMutex.lock();
+		*planes = cap->mPixels.data();
+		return nullptr;
+	}
+
+	static void CaptureUnlockCB(void* opaque, void* picture, void* const* planes)
+	{
+		sCapture* cap = (sCapture*)opaque;
+		cap->mMutex.unlock();
+	}
+
+	static void CaptureDisplayCB(void* opaque, void* picture)
+	{
+		sCapture* cap = (sCapture*)opaque;
+		std::lock_guard<std::mutex> lock(cap->mMutex);
+		if (cap->mWanted)
+		{
+			cap->mCaptured = cap->mPixels;
+			cap->mWanted = false;
+			cap->mArrived.notify_one();
+		}
+	}
+
+	// 64 bit FNV-1a hash continued over a block of bytes
+	static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (uint64_t)bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Queue extraction of count thumbnails packed columns per row
+	int Thumbnailer::Request(const char* path, const int64_t* times, int count, int thumbWidth, int thumbHeight, int columns)
+	{
+		if (path == nullptr || times == nullptr
+			|| count <= 0 || count > MaxThumbnails
+			|| thumbWidth <= 0 || thumbWidth > MaxThumbnailSize
+			|| thumbHeight <= 0 || thumbHeight > MaxThumbnailSize
+			|| columns <= 0)
+		{
+			return 0;
+		}
+
+		sJob* job = new sJob();
+		job->mPath = path;
+		job->mIsURL = PathIsURL(path);
+		job->mTimes.assign(times, times + count);
+		job->mThumbWidth = thumbWidth;
+		job->mThumbHeight = thumbHeight;
+		job->mColumns = (columns < count ? columns : count);
+		job->mAtlasWidth = job->mColumns * thumbWidth;
+		job->mAtlasHeight = ((count + job->mColumns - 1) / job->mColumns) * thumbHeight;
+		job->mStatus = ThumbPending;
+		job->mForgotten = false;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		job->mId = mNextId++;
+		mJobs[job->mId] = job;
+		mQueue.push_back(job);
+		mWake.notify_one();
+		return job->mId;
+	}
+
+	// Returns request status and, once ready, the atlas size
+	eThumbStatus Thumbnailer::GetStatus(int id, int* atlasWidth, int* atlasHeight)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mJobs.find(id);
+		if (it == mJobs.end())
+		{
+			return ThumbUnknown;
+		}
+		*atlasWidth = it->second->mAtlasWidth;
+		*atlasHeight = it->second->mAtlasHeight;
+		return it->second->mStatus;
+	}
+
+	// Copy a ready atlas to buffer
+	bool Thumbnailer::CopyAtlas(int id, void* buffer, int size)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mJobs.find(id);
+		if (it == mJobs.end() || it->second->mStatus != ThumbReady || size < (int)it->second->mAtlas.size())
+		{
+			return false;
+		}
+		memcpy(buffer, it->second->mAtlas.data(), it->second->mAtlas.size());
+		return true;
+	}
+
+	// Discard a request. Queued jobs are deleted, a job being extracted is deleted by its worker.
+	void Thumbnailer::Forget(int id)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mJobs.find(id);
+		if (it == mJobs.end())
+		{
+			return;
+		}
+		sJob* job = it->second;
+		mJobs.erase(it);
+
+		for (auto q = mQueue.begin(); q != mQueue.end(); ++q)
+		{
+			if (*q == job)
+			{
+				mQueue.erase(q);
+				delete job;
+				return;
+			}
+		}
+		if (job->mStatus == ThumbPending)
+		{
+			job->mForgotten = true;
+		}
+		else
+		{
+			delete job;
+		}
+	}
+
+	// Worker thread main loop: take the oldest job, serve it from disk or extract it
+	void Thumbnailer::WorkerMain()
+	{
+		for (;;)
+		{
+			sJob* job = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWake.wait(lock, [this] { return mQuit || !mQueue.empty(); });
+				if (mQuit)
+				{
+					return;
+				}
+				job = mQueue.front();
+				mQueue.pop_front();
+			}
+
+			// Worker owns the job's atlas until the status is set
+			std::string cachePath;
+			bool cached = MakeCachePath(job, &cachePath);
+			bool ok = (cached && LoadCached(job, cachePath));
+			if (!ok)
+			{
+				ok = Extract(job);
+				if (ok && cached)
+				{
+					SaveCached(job, cachePath);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (job->mForgotten)
+			{
+				delete job;
+			}
+			else
+			{
+				job->mStatus = (ok ? ThumbReady : ThumbFailed);
+			}
+		}
+	}
+
+	// Wait up to FrameTimeout for the wanted frame, giving up early if the service is being
+	// released. Returns true if the frame was captured.
+	static bool WaitForCapture(sCapture& cap, std::unique_lock<std::mutex>& lock, const std::atomic<bool>& quit, int64_t timeout, int64_t pollInterval)
+	{
+		for (int64_t waited = 0; waited < timeout && !quit.load(std::memory_order_relaxed); waited += pollInterval)
+		{
+			if (cap.mArrived.wait_for(lock, std::chrono::milliseconds(pollInterval), [&cap] { return !cap.mWanted; }))
+			{
+				return true;
+			}
+		}
+		return !cap.mWanted;
+	}
+
+	// Decode job thumbnails into its atlas. The player is kept paused between thumbnails: the seek
+	// is issued while paused (so no frame from the old position can be displayed) then playback
+	// resumes until the first frame after the seek has been captured.
+	bool Thumbnailer::Extract(sJob* job)
+	{
+		const int stride = job->mThumbWidth * 4;
+		const int frameSize = stride * job->mThumbHeight;
+		const int atlasStride = job->mAtlasWidth * 4;
+
+		libvlc_media_t* media = (job->mIsURL ? libvlc_media_new_location(mVLCInstance, job->mPath.c_str()) : libvlc_media_new_path(mVLCInstance, job->mPath.c_str()));
+		if (media == nullptr)
+		{
+			return false;
+		}
+		libvlc_media_add_option(media, ":no-audio");
+		libvlc_media_add_option(media, ":no-spu");
+		libvlc_media_add_option(media, ":input-fast-seek");
+		libvlc_media_add_option(media, ":avcodec-threads=1");
+		libvlc_media_player_t* player = libvlc_media_player_new_from_media(media);
+		libvlc_media_release(media);
+		if (player == nullptr)
+		{
+			return false;
+		}
+
+		sCapture cap;
+		cap.mPixels.resize(frameSize);
+		cap.mWanted = true;
+		libvlc_video_set_callbacks(player, CaptureLockCB, CaptureUnlockCB, CaptureDisplayCB, &cap);
+		libvlc_video_set_format(player, "RGBA", job->mThumbWidth, job->mThumbHeight, stride);
+
+		job->mAtlas.assign((size_t)atlasStride * job->mAtlasHeight, 0);
+		int decoded = 0;
+
+		// Wait for the first frame so the input is running before seeking
+		libvlc_media_player_play(player);
+		bool running;
+		{
+			std::unique_lock<std::mutex> lock(cap.mMutex);
+			running = WaitForCapture(cap, lock, mQuit, FrameTimeout, QuitPollInterval);
+		}
+		libvlc_media_player_set_pause(player, 1);
+
+		for (size_t i = 0; running && !mQuit && i < job->mTimes.size(); i++)
+		{
+			{
+				std::lock_guard<std::mutex> lock(cap.mMutex);
+				cap.mWanted = true;
+			}
+			libvlc_media_player_set_time(player, job->mTimes[i]);
+			libvlc_media_player_set_pause(player, 0);
+
+			std::unique_lock<std::mutex> lock(cap.mMutex);
+			bool arrived = WaitForCapture(cap, lock, mQuit, FrameTimeout, QuitPollInterval);
+			if (arrived)
+			{
+				int col = (int)i % job->mColumns;
+				int row = (int)i / job->mColumns;
+				uint8_t* dst = job->mAtlas.data() + (size_t)row * job->mThumbHeight * atlasStride + col * stride;
+				for (int y = 0; y < job->mThumbHeight; y++)
+				{
+					memcpy(dst + (size_t)y * atlasStride, cap.mCaptured.data() + y * stride, stride);
+				}
+				decoded++;
+			}
+			lock.unlock();
+			libvlc_media_player_set_pause(player, 1);
+		}
+
+		// Stopping waits for the callbacks to finish so cap can go out of scope
+		libvlc_media_player_stop(player);
+		libvlc_media_player_release(player);
+
+		DebugLog("Thumbnailer::Extract(%s) decoded %d of %d%s", job->mPath.c_str(), decoded, (int)job->mTimes.size(), (mQuit ? " (cancelled)" : ""));
+
+		// A partial atlas from a cancelled extraction must not be cached
+		return (decoded > 0 && !mQuit);
+	}
+
+	// Builds cache file path from the media content key and request parameters. Media that has no
+	// content key (eg. a URL, which has no ETag here) is never cached as a change couldn't be seen.
+	bool Thumbnailer::MakeCachePath(const sJob* job, std::string* path)
+	{
+		MediaInfoKey key;
+		if (mCacheDir.empty() || !MediaInfoCache::MakeKey(job->mPath.c_str(), job->mIsURL, nullptr, &key))
+		{
+			return false;
+		}
+		uint64_t hash = 14695981039346656037ull;
+		hash = HashBytes(hash, &key, sizeof(key));
+		hash = HashBytes(hash, &job->mThumbWidth, sizeof(job->mThumbWidth));
+		hash = HashBytes(hash, &job->mThumbHeight, sizeof(job->mThumbHeight));
+		hash = HashBytes(hash, &job->mColumns, sizeof(job->mColumns));
+		hash = HashBytes(hash, job->mTimes.data(), job->mTimes.size() * sizeof(int64_t));
+
+		char name[32];
+		_snprintf_s(name, sizeof(name), _TRUNCATE, "\\%016I64x.fpta", hash);
+		*path = mCacheDir + name;
+		return true;
+	}
+
+	// Read atlas from cache file, returns false if missing or not matching the request
+	bool Thumbnailer::LoadCached(sJob* job, const std::string& path)
+	{
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, path.c_str(), "rb") != 0)
+		{
+			return false;
+		}
+		ThumbnailAtlasHeader header;
+		bool ok = (fread(&header, sizeof(header), 1, fp) == 1
+			&& header.mMagic == kMagic
+			&& header.mVersion == kVersion
+			&& header.mWidth == job->mAtlasWidth
+			&& header.mHeight == job->mAtlasHeight);
+		if (ok)
+		{
+			job->mAtlas.resize((size_t)header.mWidth * header.mHeight * 4);
+			ok = (fread(job->mAtlas.data(), job->mAtlas.size(), 1, fp) == 1);
+		}
+		fclose(fp);
+		return ok;
+	}
+
+	// Write atlas to cache file (via a temporary file so a partial file is never read)
+	void Thumbnailer::SaveCached(const sJob* job, const std::string& path)
+	{
+		std::string tmpPath = path + ".tmp";
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, tmpPath.c_str(), "wb") != 0)
+		{
+			DebugLog("Thumbnailer::SaveCached() failed to open %s", tmpPath.c_str());
+			return;
+		}
+		ThumbnailAtlasHeader header;
+		header.mMagic = kMagic;
+		header.mVersion = kVersion;
+		header.mWidth = job->mAtlasWidth;
+		header.mHeight = job->mAtlasHeight;
+		bool written = (fwrite(&header, sizeof(header), 1, fp) == 1
+			&& fwrite(job->mAtlas.data(), job->mAtlas.size(), 1, fp) == 1);
+		fclose(fp);
+		if (!written || !MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DebugLog("Thumbnailer::SaveCached() failed to write %s", path.c_str());
+			DeleteFileA(tmpPath.c_str());
+		}
+	}
+
+	// Create the service with numWorkers threads (0 = one per core)
+	Thumbnailer* Thumbnailer::Create(int numWorkers, const char* cacheDir)
+	{
+		Thumbnailer* tn = new Thumbnailer();
+		tn->mVLCInstance = libvlc_new(0, NULL);
+		if (tn->mVLCInstance == nullptr)
+		{
+			DebugLogS("Thumbnailer::Create() failed to create libvlc instance");
+			delete tn;
+			return nullptr;
+		}
+
+		if (cacheDir != nullptr && cacheDir[0] != '\0')
+		{
+			tn->mCacheDir = cacheDir;
+			CreateDirectoryA(cacheDir, NULL);
+		}
+
+		if (numWorkers <= 0)
+		{
+			numWorkers = (int)std::thread::hardware_concurrency();
+		}
+		numWorkers = (numWorkers < 1 ? 1 : (numWorkers > MaxWorkers ? MaxWorkers : numWorkers));
+		for (int i = 0; i < numWorkers; i++)
+		{
+			tn->mWorkers.push_back(std::thread(&Thumbnailer::WorkerMain, tn));
+		}
+		DebugLog("Thumbnailer::Create() %d workers, cache %s", numWorkers, (tn->mCacheDir.empty() ? "off" : tn->mCacheDir.c_str()));
+		return tn;
+	}
+
+	// Cancel outstanding requests, stop the workers and release the service. Workers part way
+	// through an extraction abandon it within QuitPollInterval of the current frame wait.
+	void Thumbnailer::Release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+			mWake.notify_all();
+		}
+		for (size_t i = 0; i < mWorkers.size(); i++)
+		{
+			mWorkers[i].join();
+		}
+		delete this;
+	}
+
+	// Constructor
+	Thumbnailer::Thumbnailer()
+	{
+		mVLCInstance = nullptr;
+		mNextId = 1;
+		mQuit = false;
+	}
+
+	// Destructor: workers have stopped so all remaining jobs can be freed
+	Thumbnailer::~Thumbnailer()
+	{
+		for (auto it = mJobs.begin(); it != mJobs.end(); ++it)
+		{
+			delete it->second;
+		}
+		if (mVLCInstance != nullptr)
+		{
+			libvlc_release(mVLCInstance);
+		}
+	}
+}
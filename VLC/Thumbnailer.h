@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vlc/vlc.h>
+
+// ---------------------------------------------------------------------------
+// Thumbnailer Class
+//
+// Background extraction of thumbnails packed into a sprite sheet (atlas). A
+// pool of worker threads shares one libvlc instance, each worker takes a
+// request (media path plus a list of timestamps) and decodes it with a
+// lightweight player: no audio, one decode thread and keyframe seeking, so
+// only the keyframe at or before each timestamp is decoded. libvlc scales
+// frames to the thumbnail size and they are packed row major into a single
+// RGBA atlas.
+//
+// Atlases are cached on disk keyed by the media's content key (path, size and
+// last write time, see MediaInfoCache::MakeKey) and the request parameters,
+// so repeated requests for unchanged media are read from disk.
+//
+// Cache file layout:
+//		ThumbnailAtlasHeader
+//		RGBA pixels (mWidth * mHeight * 4 bytes)
+
+namespace FPVR
+{
+	class Thumbnailer;
+
+	extern Thumbnailer* gThumbnailer;
+
+	// Request status
+	typedef enum
+	{
+		ThumbUnknown = -1,				// No such request
+		ThumbPending = 0,				// Queued or being extracted
+		ThumbReady = 1,					// Atlas can be copied
+		ThumbFailed = 2					// Media could not be opened or no frame was decoded
+	} eThumbStatus;
+
+	// Header at start of an atlas cache file
+	typedef struct
+	{
+		uint32_t mMagic;				// kMagic
+		uint32_t mVersion;				// kVersion
+		int32_t mWidth;					// Atlas width in pixels
+		int32_t mHeight;				// Atlas height in pixels
+	} ThumbnailAtlasHeader;
+
+	class Thumbnailer
+	{
+	public:
+		static const uint32_t kMagic = 0x41545046;	// 'FPTA'
+		static const uint32_t kVersion = 1;
+
+		static const int MaxWorkers = 16;
+		static const int MaxThumbnails = 1024;
+		static const int MaxThumbnailSize = 1024;
+		static const int64_t FrameTimeout = 3000;	// Milliseconds to wait for a frame after a seek
+		static const int64_t QuitPollInterval = 50;	// Milliseconds between checks for quit while waiting for a frame
+
+		// Create the service with numWorkers threads (0 = one per core). Atlases are cached in
+		// cacheDir if it is not null.
+		static Thumbnailer* Create(int numWorkers, const char* cacheDir);
+
+		// Cancel outstanding requests, stop the workers and release the service
+		void Release();
+
+		// Queue extraction of count thumbnails (times in milliseconds) of thumbWidth x thumbHeight
+		// packed columns per row. Returns request id (0 if arguments are invalid).
+		int Request(const char* path, const int64_t* times, int count, int thumbWidth, int thumbHeight, int columns);
+
+		// Returns request status and, once ready, the atlas size
+		eThumbStatus GetStatus(int id, int* atlasWidth, int* atlasHeight);
+
+		// Copy a ready atlas (atlasWidth * atlasHeight * 4 bytes) to buffer
+		bool CopyAtlas(int id, void* buffer, int size);
+
+		// Discard a request (cancels it if it has not started)
+		void Forget(int id);
+
+	protected:
+		typedef struct
+		{
+			int mId;
+			std::string mPath;
+			bool mIsURL;
+			std::vector<int64_t> mTimes;
+			int mThumbWidth;
+			int mThumbHeight;
+			int mColumns;
+			int mAtlasWidth;
+			int mAtlasHeight;
+			std::vector<uint8_t> mAtlas;	// RGBA atlas (valid when ready)
+			eThumbStatus mStatus;
+			bool mForgotten;				// Released by caller while a worker had it
+		} sJob;
+
+		libvlc_instance_t* mVLCInstance;	// Shared by all workers
+		std::string mCacheDir;				// Empty if atlases are not cached
+
+		std::mutex mMutex;					// Protects everything below
+		std::condition_variable mWake;		// Signalled when a job is queued or on quit
+		std::deque<sJob*> mQueue;			// Jobs waiting for a worker
+		std::unordered_map<int, sJob*> mJobs;	// All jobs not forgotten by id
+		int mNextId;
+		std::atomic<bool> mQuit;			// Set by Release, also read by workers mid-extraction
+
+		std::vector<std::thread> mWorkers;
+
+		// Worker thread main loop
+		void WorkerMain();
+
+		// Decode job thumbnails into its atlas, returns false if nothing was decoded or the
+		// service is being released
+		bool Extract(sJob* job);
+
+		// Disk cache
+		bool MakeCachePath(const sJob* job, std::string* path);
+		bool LoadCached(sJob* job, const std::string& path);
+		void SaveCached(const sJob* job, const std::string& path);
+
+		Thumbnailer();
+		~Thumbnailer();
+	};
+}
@@ -0,0 +1,171 @@
+// ---------------------------------------------------------------------------
+// Trace Spans
+//
+// Per-thread span rings and Chrome trace event JSON export
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include <windows.h>
+
+#include "PluginUtils.h"
+#include "Trace.h"
+
+namespace FPVR
+{
+#if FPVR_ENABLE_TRACE
+	typedef struct
+	{
+		const char* mName;
+		int64_t mStart;						// Nanoseconds
+		int64_t mEnd;
+	} sTraceEvent;
+
+	// Span ring owned by one thread. Only the owner writes, mCount is published after each span
+	// so a dump reads complete spans (the oldest may be overwritten while a dump is running).
+	typedef struct
+	{
+		uint32_t mThreadId;
+		bool mInUse;						// Owned by a running thread (gTraceBuffersMutex)
+		std::atomic<uint32_t> mCount;		// Spans recorded (wraps the ring)
+		std::atomic<uint32_t> mClearCount;	// mCount when last cleared
+		sTraceEvent mEvents[TraceEventsPerThread];
+	} sTraceBuffer;
+
+	std::atomic<bool> gTraceEnabled(false);
+
+	// Every buffer created. A thread's buffer is handed back when it ends and reused by the next
+	// new thread, so the number of buffers is bounded by the most threads ever recording at once.
+	// Until then its spans still appear in dumps.
+	static std::mutex gTraceBuffersMutex;
+	static std::vector<sTraceBuffer*> gTraceBuffers;
+
+	// Holds the calling thread's buffer and hands it back when the thread ends
+	class TraceBufferOwner
+	{
+	public:
+		TraceBufferOwner() { mBuffer = nullptr; }
+
+		~TraceBufferOwner()
+		{
+			if (mBuffer != nullptr)
+			{
+				std::lock_guard<std::mutex> lock(gTraceBuffersMutex);
+				mBuffer->mInUse = false;
+			}
+		}
+
+		sTraceBuffer* mBuffer;
+	};
+
+	static thread_local TraceBufferOwner tTraceBuffer;
+
+	// Take a buffer no thread owns, or create one (gTraceBuffersMutex held)
+	static sTraceBuffer* AcquireTraceBuffer()
+	{
+		for (size_t i = 0; i < gTraceBuffers.size(); i++)
+		{
+			if (!gTraceBuffers[i]->mInUse)
+			{
+				return gTraceBuffers[i];
+			}
+		}
+		sTraceBuffer* buffer = new sTraceBuffer();
+		gTraceBuffers.push_back(buffer);
+		return buffer;
+	}
+
+	// Monotonic time used to stamp spans (nanoseconds)
+	int64_t TraceNow()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Record a completed span on the calling thread, its buffer is acquired on first use
+	void TraceRecord(const char* name, int64_t start, int64_t end)
+	{
+		sTraceBuffer* buffer = tTraceBuffer.mBuffer;
+		if (buffer == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(gTraceBuffersMutex);
+			buffer = AcquireTraceBuffer();
+			buffer->mThreadId = (uint32_t)GetCurrentThreadId();
+			buffer->mInUse = true;
+			buffer->mCount = 0;
+			buffer->mClearCount = 0;
+			tTraceBuffer.mBuffer = buffer;
+		}
+
+		uint32_t count = buffer->mCount.load(std::memory_order_relaxed);
+		sTraceEvent& ev = buffer->mEvents[count % TraceEventsPerThread];
+		ev.mName = name;
+		ev.mStart = start;
+		ev.mEnd = end;
+		buffer->mCount.store(count + 1, std::memory_order_release);
+	}
+#endif
+
+	// Start or stop recording spans
+	void SetTraceEnabled(bool enable)
+	{
+#if FPVR_ENABLE_TRACE
+		gTraceEnabled = enable;
+#endif
+	}
+
+	// Discard all recorded spans
+	void ClearTrace()
+	{
+#if FPVR_ENABLE_TRACE
+		std::lock_guard<std::mutex> lock(gTraceBuffersMutex);
+		for (size_t i = 0; i < gTraceBuffers.size(); i++)
+		{
+			gTraceBuffers[i]->mClearCount = gTraceBuffers[i]->mCount.load(std::memory_order_acquire);
+		}
+#endif
+	}
+
+	// Write recorded spans as Chrome trace event JSON: one complete ("X") event per span with
+	// microsecond timestamps, plus thread name metadata so threads are labelled by id.
+	bool DumpTrace(const char* path)
+	{
+#if FPVR_ENABLE_TRACE
+		FILE* fp;
+		if (path == nullptr || fopen_s(&fp, path, "w") != 0)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(gTraceBuffersMutex);
+		fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+		for (size_t i = 0; i < gTraceBuffers.size(); i++)
+		{
+			sTraceBuffer* buffer = gTraceBuffers[i];
+			uint32_t count = buffer->mCount.load(std::memory_order_acquire);
+			uint32_t begin = buffer->mClearCount.load(std::memory_order_relaxed);
+			if (count - begin > (uint32_t)TraceEventsPerThread)
+			{
+				begin = count - TraceEventsPerThread;
+			}
+
+			fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}", (first ? "" : ",\n"), buffer->mThreadId, buffer->mThreadId);
+			first = false;
+			for (uint32_t n = begin; n != count; n++)
+			{
+				const sTraceEvent& ev = buffer->mEvents[n % TraceEventsPerThread];
+				fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					ev.mName, buffer->mThreadId, (double)ev.mStart / 1000.0, (double)(ev.mEnd - ev.mStart) / 1000.0);
+			}
+		}
+		fprintf(fp, "\n]}\n");
+		fclose(fp);
+		DebugLog("DumpTrace(%s)", path);
+		return true;
+#else
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Trace Spans
+//
+// Scoped timing spans for diagnosing hitches in the frame pipeline. Each
+// thread records into its own fixed size ring (acquired on first use and
+// reused by a later thread once it ends) so recording takes no locks,
+// timestamps are from the steady clock. Recording
+// is switched on and off at runtime and the rings can be dumped on demand in
+// the Chrome trace event JSON format (chrome://tracing or ui.perfetto.dev).
+//
+// Spans are compiled out entirely unless FPVR_ENABLE_TRACE is defined to 1,
+// FPVR_TRACE_SCOPE then expands to nothing and the dump reports failure.
+
+#ifndef FPVR_ENABLE_TRACE
+#define FPVR_ENABLE_TRACE 0
+#endif
+
+#if FPVR_ENABLE_TRACE
+#define FPVR_TRACE_CONCAT2(a, b)	a##b
+#define FPVR_TRACE_CONCAT(a, b)		FPVR_TRACE_CONCAT2(a, b)
+#define FPVR_TRACE_SCOPE(name)		FPVR::TraceScope FPVR_TRACE_CONCAT(sTraceScope, __LINE__)(name)
+#else
+#define FPVR_TRACE_SCOPE(name)
+#endif
+
+namespace FPVR
+{
+	// Spans kept per thread (oldest are overwritten)
+	static const int TraceEventsPerThread = 16384;
+
+	// Start or stop recording spans
+	extern void SetTraceEnabled(bool enable);
+
+	// Discard all recorded spans
+	extern void ClearTrace();
+
+	// Write recorded spans to path as Chrome trace event JSON, returns false if tracing is
+	// compiled out or the file can't be written
+	extern bool DumpTrace(const char* path);
+
+#if FPVR_ENABLE_TRACE
+	extern std::atomic<bool> gTraceEnabled;
+
+	// Monotonic time used to stamp spans (nanoseconds)
+	extern int64_t TraceNow();
+
+	// Record a completed span on the calling thread (name must be a string literal)
+	extern void TraceRecord(const char* name, int64_t start, int64_t end);
+
+	// Records a span covering its lifetime
+	class TraceScope
+	{
+	public:
+		TraceScope(const char* name)
+		{
+			mName = name;
+			mStart = (gTraceEnabled.load(std::memory_order_relaxed) ? TraceNow() : 0);
+		}
+
+		~TraceScope()
+		{
+			if (mStart != 0)
+			{
+				TraceRecord(mName, mStart, TraceNow());
+			}
+		}
+
+	protected:
+		const char* mName;
+		int64_t mStart;		// 0 if not recording
+	};
+#endif
+}
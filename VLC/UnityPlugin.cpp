@@ -60,6 +60,7 @@ namespace FPVR
 	{
 		DebugLog("UnityPlugin::Unload");
 		mUnityGraphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+		DebugLogShutdown();
 	}
 
 	// Called when a graphics event is called
@@ -5,6 +5,9 @@
 
 #include "PluginUtils.h"
 #include "VideoFrameManager.h"
+#include "AudioUtils.h"
+#include "PlayerStatus.h"
+#include "Trace.h"
 #include "VLCMediaPlayer.h"
 
 // --------------------------------------------------------------------------
@@ -29,6 +32,7 @@ namespace FPVR
 		{
 			return mp;
 		}
+		delete mp;
 		return nullptr;
 	}
 
@@ -56,9 +60,46 @@ namespace FPVR
 			mVLCMedia = nullptr;
 		}
 
+		// Playlist items (the live item's player was released above)
+		ReleasePlaylistItem(mLiveItem);
+		mLiveItem = nullptr;
+		ReleasePlaylistItem(mNextItem);
+		mNextItem = nullptr;
+		if (mNextPath != nullptr)
+		{
+			free(mNextPath);
+			mNextPath = nullptr;
+		}
+
+		// Audio callbacks have stopped so the ring can be emptied
+		if (mAudioRing != nullptr)
+		{
+			mAudioRing->Reset();
+		}
+		mAudioPaused = false;
+		mAudioChannels = 0;
+		mAudioClockValid = false;
+		mAudioResync = true;
+		mAudioLag = 0;
+
 		mPrepared = false;
 		mReachedEnd = false;
 		mHadVideoRenderingStart = false;
+		mPreparedFromCache = false;
+		mPrepareEventPending = false;
+		mSeekPending = false;
+		mScrubTargetPending = false;
+		ReleaseScrubDecoders();
+		mLoopPrepared = false;
+		mLoopStopPending = false;
+		mLastReportedTime = 0;
+		mLoopWrapTime = 0;
+		mItemSwitchTime = 0;
+		mNumFrameTimes = 0;
+		if (mPlaybackClock != nullptr)
+		{
+			mPlaybackClock->Reset();
+		}
 
 		// All states unknown
 		mVideoWidth = -1;
@@ -66,6 +107,8 @@ namespace FPVR
 		mVideoDuration = -1;
 		mMediaIsSeekable = true;
 		mMediaIsPausable = true;
+		mBufferingPercent = 0;
+		mState = libvlc_NothingSpecial;
 
 		mNumAudioChannels = 0;
 		for(int i = 0; i < MaxAudioChannels; i++)
@@ -73,31 +116,36 @@ namespace FPVR
 			mChannelStereo[i] = false;
 			mChannelFrequency[i] = 0;
 		}
+		mNumVideoTracks = -1;
+		mNumAudioTracks = -1;
+		mNumSubtitleTracks = -1;
+		mHaveMediaInfoKey = false;
+
 		if (mVideoPath != nullptr)
 		{
 			free(mVideoPath);
 			mVideoPath = nullptr;
 		}
+		if (mVideoETag != nullptr)
+		{
+			free(mVideoETag);
+			mVideoETag = nullptr;
+		}
 		mVideoPathIsURL = false;
+		if (mMemorySource != nullptr)
+		{
+			mMemorySource->Release();
+			mMemorySource = nullptr;
+		}
 
 		ClearMediaEvents();
 	}
 
-	// Returns true if path refers to a URL. Currently assumes local if not one of our recognised schemes
-	static bool PathIsURL(const char* path)
-	{
-		return (_strnicmp(path, "http:", 5) == 0
-			|| _strnicmp(path, "https:", 6) == 0
-			|| _strnicmp(path, "rtsp:", 5) == 0
-			|| _strnicmp(path, "rtmp:", 5) == 0
-			|| _strnicmp(path, "file:", 5) == 0);
-	}
-
 	// ---------------------------------------------------------------------------------------------
 	// Setup functions, these must be called prior to calling prepare
 
 	// Set the path to the media to be played. Ignored if player is not in idle state
-	bool VLCMediaPlayer::SetDataSource(const char* path)
+	bool VLCMediaPlayer::SetDataSource(const char* path, const char* etag)
 	{
 		if (mVLCMedia == nullptr)
 		{
@@ -113,7 +161,17 @@ namespace FPVR
 			{
 				mVideoPath = nullptr;
 			}
+			if (mVideoETag != nullptr)
+			{
+				free(mVideoETag);
+			}
+			mVideoETag = (etag != nullptr ? _strdup(etag) : nullptr);
 			mVideoPathIsURL = (mVideoPath != nullptr && PathIsURL(mVideoPath));
+			if (mMemorySource != nullptr)
+			{
+				mMemorySource->Release();
+				mMemorySource = nullptr;
+			}
 			DebugLog("VLCMediaPlayer::SetDataSource(%s=%s)", (mVideoPathIsURL ? "url" : "path"), (mVideoPath == nullptr ? "null" : mVideoPath));
 			return true;
 		}
@@ -124,15 +182,63 @@ namespace FPVR
 		}
 	}
 
+	// Play media from a caller owned memory region
+	bool VLCMediaPlayer::SetDataSourceMemory(const void* data, uint64_t size)
+	{
+		if (!MemorySource::IsSupported())
+		{
+			DebugLogS("VLCMediaPlayer::SetDataSourceMemory() requires libvlc 3.0");
+			AddMediaEvent(eMPEvent::OnError, eMPError::InternalError);
+			return false;
+		}
+		return SetMemorySource(MemorySource::Create(data, size));
+	}
+
+	// Play media from a region of a memory mapped pack file
+	bool VLCMediaPlayer::SetDataSourcePackFile(const char* path, uint64_t offset, uint64_t size)
+	{
+		if (!MemorySource::IsSupported())
+		{
+			DebugLogS("VLCMediaPlayer::SetDataSourcePackFile() requires libvlc 3.0");
+			AddMediaEvent(eMPEvent::OnError, eMPError::InternalError);
+			return false;
+		}
+		return SetMemorySource(MemorySource::CreateFromFile(path, offset, size));
+	}
+
+	// Replace the data source with a memory source (takes ownership). The path is cleared so
+	// path based features (media info cache, scrub decoders) are not used for this media.
+	bool VLCMediaPlayer::SetMemorySource(MemorySource* source)
+	{
+		if (mVLCMedia != nullptr)
+		{
+			if (source != nullptr)
+			{
+				source->Release();
+			}
+			AddMediaEvent(eMPEvent::OnError, eMPError::IncompatibleState);
+			return false;
+		}
+		if (source == nullptr)
+		{
+			AddMediaEvent(eMPEvent::OnError, eMPError::BadArgument);
+			return false;
+		}
+
+		SetDataSource(nullptr);
+		mMemorySource = source;
+		DebugLog("VLCMediaPlayer::SetMemorySource(size=%I64u)", source->Size());
+		return true;
+	}
+
 	// Set the texture the media is to be played back to
 	bool VLCMediaPlayer::SetTexture(void* texture, int width, int height, eTexFmt texFmt)
 	{
-		DebugLogS("SetTexture 0004");
 		if (mVLCMedia == nullptr)
 		{
 			mFrameManager->SetTarget(texture, width, height, texFmt);
 			DumpTextureDesc(texture);
-			DebugLog("VLCMediaPlayer::SetSurface(texture=%08x, width=%d, height=%d, format=%s)", texture, width, height, GetTexFmtFourCC(texFmt));
+			FPVR_LOG_DEBUG("VLCMediaPlayer::SetSurface(texture=%08x, width=%d, height=%d, format=%s)", texture, width, height, GetTexFmtFourCC(texFmt));
 			return true;
 		}
 		else
@@ -178,6 +284,7 @@ namespace FPVR
 	void VLCMediaPlayer::OnVLCEvent(const libvlc_event_t* ev, void* vsmp)
 	{
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)vsmp;
+		bool logging = FPVR_LOG_ENABLED(LogDebug);
 		char extra[64];
 		extra[0] = '\0';
 
@@ -191,19 +298,48 @@ namespace FPVR
 				libvlc_video_get_size(mp->mVLCMediaPlayer, 0, &w, &h);
 				mp->mVideoWidth = w;
 				mp->mVideoHeight = h;
-				mp->AddMediaEvent(eMPEvent::OnPrepared);
+				mp->ReadTrackInfo();
+
+				// If cached info was used OnPrepared may already have been sent on playing
 				mp->mPrepared = true;
+				if (mp->mPrepareEventPending.exchange(false))
+				{
+					mp->AddMediaEvent(eMPEvent::OnPrepared);
+				}
+				mp->StoreMediaInfo();
+			}
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "parsed=%d, w=%d, h=%d", ev->u.media_parsed_changed.new_status, w, h);
 			}
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "parsed=%d, w=%d, h=%d", ev->u.media_parsed_changed.new_status, w, h);
 			break;
 		}
+		case libvlc_MediaPlayerOpening:
+			mp->mState = libvlc_Opening;
+			break;
 		case libvlc_MediaPlayerPlaying:
+			mp->mState = libvlc_Playing;
+
+			// The input has opened, with cached info there's no need to wait for the parse
+			if (mp->mPreparedFromCache && mp->mPrepareEventPending.exchange(false))
+			{
+				mp->mPrepared = true;
+				mp->AddMediaEvent(eMPEvent::OnPrepared);
+			}
+			mp->mPlaybackClock->SetPaused(false, libvlc_clock());
 			mp->AddMediaEvent(eMPEvent::OnPlaying);
 			break;
 		case libvlc_MediaPlayerPaused:
+			mp->mState = libvlc_Paused;
+			mp->mPlaybackClock->SetPaused(true, libvlc_clock());
 			mp->AddMediaEvent(eMPEvent::OnPaused);
 			break;
+		case libvlc_MediaPlayerStopped:
+			mp->mState = libvlc_Stopped;
+			mp->mPlaybackClock->SetPaused(true, libvlc_clock());
+			break;
 		case libvlc_MediaPlayerBuffering:
+			mp->mBufferingPercent = (int)ev->u.media_player_buffering.new_cache;
 			if (ev->u.media_player_buffering.new_cache >= 100.0f)
 			{
 					mp->AddMediaEvent(eMPEvent::OnBufferingEnd);
@@ -216,58 +352,103 @@ namespace FPVR
 			{
 				mp->AddMediaEvent(eMPEvent::OnBufferingProgress, ev->u.media_player_buffering.new_cache);
 			}
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "cache=%f", ev->u.media_player_buffering.new_cache);
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "cache=%f", ev->u.media_player_buffering.new_cache);
+			}
 			break;
 		case libvlc_MediaPlayerEndReached:
+			mp->mState = libvlc_Ended;
+			mp->mPlaybackClock->SetPaused(true, libvlc_clock());
 			mp->AddMediaEvent(eMPEvent::OnReachedEnd);
 			mp->mReachedEnd = true;
 			break;
 		case libvlc_MediaPlayerTimeChanged:
+			mp->mPlaybackClock->Update(ev->u.media_player_time_changed.new_time * 1000, libvlc_clock());
+			if (mp->mSeekPending && !mp->mSeekTimeReached)
+			{
+				// Reports from before the seek took effect are outside the window around the target. A
+				// fast seek may land on the keyframe before the target so its window starts earlier.
+				int64_t offset = ev->u.media_player_time_changed.new_time * 1000 - mp->mSeekTarget;
+				int64_t tolerance = (mp->mSeekMode == SeekAccurate ? SeekAccurateTolerance : SeekFastTolerance);
+				mp->mSeekTimeReached = (offset >= -tolerance && offset <= SeekReportWindow);
+			}
+			else if (mp->mLoopPrepared && ev->u.media_player_time_changed.new_time * 1000 + LoopWrapTolerance < mp->mLastReportedTime)
+			{
+				// libvlc has repeated the input (the clock has already snapped back), if looping
+				// was turned off since prepare the main thread stops it
+				if (mp->mLooping)
+				{
+					mp->RecordLoopWrap(libvlc_clock());
+				}
+				else
+				{
+					mp->mLoopStopPending = true;
+				}
+			}
+			mp->mLastReportedTime = ev->u.media_player_time_changed.new_time * 1000;
 			mp->AddMediaEvent(eMPEvent::OnPositionChanged, ev->u.media_player_time_changed.new_time);
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "new_time=%I64d", ev->u.media_player_time_changed.new_time);
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "new_time=%I64d", ev->u.media_player_time_changed.new_time);
+			}
 			break;
 		case libvlc_MediaPlayerEncounteredError:
+			mp->mState = libvlc_Error;
+			mp->mPrepareEventPending = false;
 			mp->AddMediaEvent(eMPEvent::OnError, eMPError::MediaError);
 			break;
 		case libvlc_MediaPlayerSeekableChanged:
 			mp->mMediaIsSeekable = (ev->u.media_player_seekable_changed.new_seekable != 0);
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "seekable=%d", ev->u.media_player_seekable_changed.new_seekable);
+			mp->StoreMediaInfo();
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "seekable=%d", ev->u.media_player_seekable_changed.new_seekable);
+			}
 			break;
 		case libvlc_MediaPlayerPausableChanged:
 			mp->mMediaIsPausable = (ev->u.media_player_pausable_changed.new_pausable != 0);
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "pausable=%d", ev->u.media_player_pausable_changed.new_pausable);
+			mp->StoreMediaInfo();
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "pausable=%d", ev->u.media_player_pausable_changed.new_pausable);
+			}
 			break;
 		case libvlc_MediaPlayerLengthChanged:
 			mp->mVideoDuration = ev->u.media_player_length_changed.new_length;
-			_snprintf_s(extra, sizeof(extra), _TRUNCATE, "length=%I64d", ev->u.media_player_length_changed.new_length);
+			mp->StoreMediaInfo();
+			if (logging)
+			{
+				_snprintf_s(extra, sizeof(extra), _TRUNCATE, "length=%I64d", ev->u.media_player_length_changed.new_length);
+			}
 			break;
 		}
-		// TODO: detect seek complete
-
-		DebugLog("VLCMediaPlayer::OnMediaEvent(%s) - %s", libvlc_event_type_name(ev->type), extra);
+		FPVR_LOG_DEBUG("VLCMediaPlayer::OnMediaEvent(%s) - %s", libvlc_event_type_name(ev->type), extra);
 	}
 
-	// Add a media event and associated parameter to end of queue
+	// Add a media event and associated parameter to end of queue. Lock free, may be called from
+	// any thread. Position and buffering progress events replace any unread event of the same
+	// type, other events are dropped and counted if the queue is full.
 	void VLCMediaPlayer::AddMediaEvent(eMPEvent newEvent, int64_t param)
 	{
-		std::lock_guard<std::mutex> lock(mEventQueueMutex);
-		MPEvent mpEvent;
-		mpEvent.mMPEvent = newEvent;
-		mpEvent.mParam = param;
-		mEventQueue.push(mpEvent);
+		if (mEventQueue != nullptr)
+		{
+			if (!mEventQueue->Push(newEvent, param))
+			{
+				DebugLog("VLCMediaPlayer::AddMediaEvent() - queue full, dropped event %d", (int)newEvent);
+			}
+		}
 	}
 
-
+	// If returns true then retrieves next event, otherwise returns false and mpEvent unchanged
 	bool VLCMediaPlayer::GetMediaEvent(eMPEvent* mpEvent, int64_t* param)
 	{
-		std::lock_guard<std::mutex> lock(mEventQueueMutex);
-
-		if (!mEventQueue.empty())
+		MPEvent mpev;
+		if (mEventQueue != nullptr && mEventQueue->Pop(&mpev))
 		{
-			MPEvent mpev = mEventQueue.front();
+			mEventLatency.AddSince(mpev.mTimestamp);
 			*mpEvent = mpev.mMPEvent;
 			*param = mpev.mParam;
-			mEventQueue.pop();
 			return true;
 		}
 		else
@@ -276,13 +457,113 @@ namespace FPVR
 		}
 	}
 
+	// Retrieves up to maxEvents pending events in order, returns number retrieved
+	int VLCMediaPlayer::GetMediaEvents(MPEvent* mpEvents, int maxEvents)
+	{
+		int count = (mEventQueue != nullptr ? mEventQueue->PopMany(mpEvents, maxEvents) : 0);
+		if (count > 0)
+		{
+			int64_t now = LatencyHistogram::Now();
+			for (int i = 0; i < count; i++)
+			{
+				mEventLatency.Add(now - mpEvents[i].mTimestamp);
+			}
+		}
+		return count;
+	}
+
+	// Discard pending events (main thread only)
 	void VLCMediaPlayer::ClearMediaEvents()
 	{
-		std::lock_guard<std::mutex> lock(mEventQueueMutex);
-		while (!mEventQueue.empty())
+		if (mEventQueue != nullptr)
+		{
+			mEventQueue->Clear();
+		}
+	}
+
+	// Read track layout and audio format of parsed media
+	void VLCMediaPlayer::ReadTrackInfo()
+	{
+		libvlc_media_track_t** tracks = nullptr;
+		unsigned numTracks = libvlc_media_tracks_get(mVLCMedia, &tracks);
+
+		mNumVideoTracks = 0;
+		mNumAudioTracks = 0;
+		mNumSubtitleTracks = 0;
+		for (unsigned i = 0; i < numTracks; i++)
+		{
+			switch (tracks[i]->i_type)
+			{
+			case libvlc_track_video:
+				mNumVideoTracks++;
+				break;
+			case libvlc_track_audio:
+				// Channel layout is taken from the first audio track
+				if (mNumAudioTracks++ == 0)
+				{
+					mNumAudioChannels = ((int)tracks[i]->audio->i_channels < MaxAudioChannels ? (int)tracks[i]->audio->i_channels : MaxAudioChannels);
+					for (int c = 0; c < mNumAudioChannels; c++)
+					{
+						mChannelStereo[c] = (tracks[i]->audio->i_channels > 1);
+						mChannelFrequency[c] = tracks[i]->audio->i_rate;
+					}
+				}
+				break;
+			case libvlc_track_text:
+				mNumSubtitleTracks++;
+				break;
+			default:
+				break;
+			}
+		}
+		if (tracks != nullptr)
+		{
+			libvlc_media_tracks_release(tracks, numTracks);
+		}
+	}
+
+	// Apply media info (from the cache) to the player state
+	void VLCMediaPlayer::ApplyMediaInfo(const MediaInfo& info)
+	{
+		mVideoWidth = info.mVideoWidth;
+		mVideoHeight = info.mVideoHeight;
+		mVideoDuration = info.mDuration;
+		mMediaIsSeekable = (info.mIsSeekable != 0);
+		mMediaIsPausable = (info.mIsPausable != 0);
+		mNumVideoTracks = info.mNumVideoTracks;
+		mNumAudioTracks = info.mNumAudioTracks;
+		mNumSubtitleTracks = info.mNumSubtitleTracks;
+		mNumAudioChannels = (info.mAudioChannels < MaxAudioChannels ? info.mAudioChannels : MaxAudioChannels);
+		for (int c = 0; c < mNumAudioChannels; c++)
+		{
+			mChannelStereo[c] = (info.mAudioChannels > 1);
+			mChannelFrequency[c] = info.mAudioRate;
+		}
+	}
+
+	// Write current media info to the media info cache (only once media has been parsed), a batch
+	// of new records is saved to the cache file from here when due
+	void VLCMediaPlayer::StoreMediaInfo()
+	{
+		if (gMediaInfoCache == nullptr || !mHaveMediaInfoKey || !mPrepared || mNumVideoTracks < 0)
 		{
-			mEventQueue.pop();
+			return;
 		}
+
+		MediaInfo info;
+		info.mDuration = mVideoDuration;
+		info.mVideoWidth = mVideoWidth;
+		info.mVideoHeight = mVideoHeight;
+		info.mIsSeekable = (mMediaIsSeekable ? 1 : 0);
+		info.mIsPausable = (mMediaIsPausable ? 1 : 0);
+		info.mNumVideoTracks = mNumVideoTracks;
+		info.mNumAudioTracks = mNumAudioTracks;
+		info.mNumSubtitleTracks = mNumSubtitleTracks;
+		info.mAudioChannels = mNumAudioChannels;
+		info.mAudioRate = (mNumAudioChannels > 0 ? mChannelFrequency[0] : 0);
+		info.mReserved = 0;
+		gMediaInfoCache->Store(mMediaInfoKey, info);
+		gMediaInfoCache->SaveIfDue();
 	}
 
 	void VLCMediaPlayer::AttachMediaEvents()
@@ -314,9 +595,13 @@ namespace FPVR
 		void*	opaque,		// Pointer to this VLCMediaPlayer passed to libvlc_video_set_callbacks()
 		void**	planes)		// start address of the pixel planes (LibVLC allocates the array of void pointers, this callback must initialize the array)
 	{
+		FPVR_TRACE_SCOPE("VLCLockCB");
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)opaque;
+		int64_t start = LatencyHistogram::Now();
 		VideoFrame* frame = mp->mFrameManager->GetFrame();
 		assert(frame != nullptr);
+		frame->SetLockTime(LatencyHistogram::Now());
+		mp->mLockWaitLatency.Add(frame->LockTime() - start);
 
 		*planes = frame->Pixels();
 
@@ -332,8 +617,11 @@ namespace FPVR
 		void*		picture,	// Pointer to VideoFrame returned from the VLCLockCB callback()
 		void*const*	planes)		// Pixel planes as defined by the libvlc_video_lock_cb callback (this parameter is only for convenience)
 	{
-		//VLCMediaPlayer* vmp = (VLCMediaPlayer*)opaque;
-		//VideoFrame* frame = (VideoFrame*)picture;
+		FPVR_TRACE_SCOPE("VLCUnlockCB");
+		VLCMediaPlayer* mp = (VLCMediaPlayer*)opaque;
+		VideoFrame* frame = (VideoFrame*)picture;
+		mp->mConvertLatency.AddSince(frame->LockTime());
+		mp->mBytesConverted.fetch_add(frame->DataSize(), std::memory_order_relaxed);
 
 		//DebugLog("VLCUnlockCB plane:%08x, frame:%08x", *planes, picture);
 	}
@@ -344,9 +632,28 @@ namespace FPVR
 		void*	opaque,			// Pointer to VideoFrameManager passed to libvlc_video_set_callbacks()
 		void*	picture)		// Pointer to VideoFrame returned from the VLCLockCB callback()
 	{
+		FPVR_TRACE_SCOPE("VLCDisplayCB");
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)opaque;
 		VideoFrame* frame = (VideoFrame*)picture;
-		mp->mFrameManager->DisplayFrame(frame);
+
+		// After a seek frames are withheld until libvlc reports a time in the seek's window (with a
+		// timeout so a seek that never reports can't freeze video), so a frame decoded before the
+		// seek took effect can't complete it
+		int64_t now = libvlc_clock();
+		if (mp->mSeekPending)
+		{
+			if (!mp->mSeekTimeReached && now - mp->mSeekStart < SeekTimeout)
+			{
+				mp->mFrameManager->DiscardFrame(frame);
+				return;
+			}
+			mp->CompleteSeek(now);
+		}
+
+		// libvlc calls this when it wants the frame shown, which is the time we queue it for
+		mp->mFramesDecoded.fetch_add(1, std::memory_order_relaxed);
+		mp->mFrameManager->DisplayFrame(frame, now);
+		mp->UpdateFrameGaps(now);
 
 		// TODO: Actually first frame has only been rendered when the first copy to in the
 		// frame manager has completed. So this needs to move to the frame manager
@@ -358,6 +665,306 @@ namespace FPVR
 		//DebugLog("VLCDisplayCB frame:%08x", frame);
 	}
 
+	// Send OnSeekComplete and record seek latency. Called from the video thread when the first
+	// frame after a seek is queued for display.
+	void VLCMediaPlayer::CompleteSeek(int64_t now)
+	{
+		if (!mSeekPending.exchange(false))
+		{
+			return;
+		}
+
+		int64_t latency = now - mSeekStart;
+		{
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			mStats.mSeekCount++;
+			mStats.mLastSeekLatency = latency;
+			mStats.mTotalSeekLatency += latency;
+			if (latency > mStats.mMaxSeekLatency)
+			{
+				mStats.mMaxSeekLatency = latency;
+			}
+		}
+		AddMediaEvent(eMPEvent::OnSeekComplete, mSeekTarget / 1000);
+	}
+
+	// Count a wrap to the start of the media and start measuring its gap (event or main thread)
+	void VLCMediaPlayer::RecordLoopWrap(int64_t now)
+	{
+		int64_t loops;
+		{
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			loops = ++mStats.mLoopCount;
+		}
+		mLoopWrapTime = now;
+		AddMediaEvent(eMPEvent::OnLooped, loops);
+	}
+
+	// Longest interval between frames displayed within LoopGapWindow either side of time
+	// (video thread)
+	int64_t VLCMediaPlayer::MaxFrameInterval(int64_t time)
+	{
+		static const unsigned int kMask = LoopFrameHistory - 1;
+		int64_t gap = 0;
+		unsigned int count = (mNumFrameTimes < (unsigned int)LoopFrameHistory ? mNumFrameTimes : (unsigned int)LoopFrameHistory);
+		for (unsigned int i = 1; i < count; i++)
+		{
+			int64_t t1 = mFrameTimes[(mNumFrameTimes - i) & kMask];
+			int64_t t0 = mFrameTimes[(mNumFrameTimes - i - 1) & kMask];
+			if (t1 < time - LoopGapWindow)
+			{
+				break;
+			}
+			gap = (t1 - t0 > gap ? t1 - t0 : gap);
+		}
+		return gap;
+	}
+
+	// Record frame display time. Once LoopGapWindow has passed since a loop wrap or playlist
+	// item switch the longest interval between frames displayed around it is recorded as its gap
+	// (a seamless transition shows about one frame interval, a restart shows the black / frozen
+	// time).
+	void VLCMediaPlayer::UpdateFrameGaps(int64_t now)
+	{
+		static const unsigned int kMask = LoopFrameHistory - 1;
+		mFrameTimes[mNumFrameTimes++ & kMask] = now;
+
+		int64_t wrap = mLoopWrapTime;
+		if (wrap != 0 && now - wrap >= LoopGapWindow)
+		{
+			mLoopWrapTime = 0;
+			int64_t gap = MaxFrameInterval(wrap);
+
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			mStats.mLastLoopGap = gap;
+			if (gap > mStats.mMaxLoopGap)
+			{
+				mStats.mMaxLoopGap = gap;
+			}
+		}
+
+		int64_t switched = mItemSwitchTime;
+		if (switched != 0 && now - switched >= LoopGapWindow)
+		{
+			mItemSwitchTime = 0;
+			int64_t gap = MaxFrameInterval(switched);
+
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			mStats.mLastSwitchGap = gap;
+			if (gap > mStats.mMaxSwitchGap)
+			{
+				mStats.mMaxSwitchGap = gap;
+			}
+		}
+	}
+
+	// Copy current statistics. Counters kept by the frame manager, event queue and audio ring
+	// are collected here so the hot paths never take mStatsMutex.
+	void VLCMediaPlayer::GetStats(MPStats* stats)
+	{
+		{
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			*stats = mStats;
+		}
+
+		VFMStats frameStats;
+		mFrameManager->GetStats(&frameStats);
+		stats->mFramesDecoded = mFramesDecoded.load(std::memory_order_relaxed);
+		stats->mFramesDisplayed = frameStats.mFramesDisplayed;
+		stats->mFramesDropped = frameStats.mFramesDropped;
+		stats->mFramesRepeated = frameStats.mFramesRepeated;
+		stats->mBytesConverted = mBytesConverted.load(std::memory_order_relaxed);
+		stats->mBytesUploaded = frameStats.mBytesUploaded;
+		stats->mPoolFrames = frameStats.mPoolFrames;
+		stats->mFreeFrames = frameStats.mFreeFrames;
+		stats->mQueuedFrames = frameStats.mQueuedFrames;
+
+		stats->mEventQueueDepth = (mEventQueue != nullptr ? mEventQueue->Depth() : 0);
+		stats->mEventOverflows = (mEventQueue != nullptr ? (int64_t)mEventQueue->OverflowCount() : 0);
+		stats->mAudioUnderruns = mAudioUnderruns.load(std::memory_order_relaxed);
+		stats->mAudioOverflows = (mAudioRing != nullptr ? (int64_t)mAudioRing->DroppedSamples() : 0);
+
+		stats->mLockWaitP50 = mLockWaitLatency.Percentile(0.5);
+		stats->mLockWaitP99 = mLockWaitLatency.Percentile(0.99);
+		stats->mConvertP50 = mConvertLatency.Percentile(0.5);
+		stats->mConvertP99 = mConvertLatency.Percentile(0.99);
+		stats->mQueueP50 = frameStats.mQueueP50;
+		stats->mQueueP99 = frameStats.mQueueP99;
+		stats->mUploadP50 = frameStats.mUploadP50;
+		stats->mUploadP99 = frameStats.mUploadP99;
+		stats->mEventP50 = mEventLatency.Percentile(0.5);
+		stats->mEventP99 = mEventLatency.Percentile(0.99);
+	}
+
+	// Configure resampler for current input format and requested output format. Only called from
+	// libvlc's audio thread (producer) so the resampler needs no locking.
+	void VLCMediaPlayer::ConfigureResampler()
+	{
+		int outRate = mAudioOutputRate;
+		mResampler->Configure(mAudioChannels, mAudioInputRate, outRate, (eResampleQuality)(int)mResampleQuality, true);
+		for (int c = 0; c < mNumAudioChannels; c++)
+		{
+			mChannelFrequency[c] = outRate;
+		}
+	}
+
+	// Producer: adjust resampling ratio to correct drift between libvlc's clock and Unity's audio
+	// clock. Lag is pulled towards zero by producing up to 0.5% more or less output per input frame,
+	// which is inaudible, so long playback stays in sync without skipping samples.
+	void VLCMediaPlayer::CorrectAudioDrift()
+	{
+		static const double kMaxAdjust = 0.005;		// Maximum ratio change
+		static const double kGain = 0.05;			// Ratio change per second of lag
+
+		double adjust = 0.0;
+		if (mAudioClockValid)
+		{
+			adjust = kGain * (double)(int64_t)mAudioLag / 1000000.0;
+			adjust = (adjust > kMaxAdjust ? kMaxAdjust : (adjust < -kMaxAdjust ? -kMaxAdjust : adjust));
+		}
+		mResampler->SetRatioAdjust(1.0 + adjust);
+	}
+
+	// Consumer: update audio clock from the next sample to be read. The time it will be heard is
+	// now plus output latency, the time libvlc wanted it heard is the end of the last block written
+	// less the duration still in the ring. Large errors (start of playback, after a flush or a long
+	// stall of Unity's audio thread) are returned so the caller can re-align with silence or a skip.
+	int VLCMediaPlayer::UpdateAudioClock(int channels)
+	{
+		static const int64_t kSmoothing = 16;		// Lag is averaged over roughly this many reads
+
+		int64_t now = libvlc_clock();
+		int64_t lastRead = mAudioLastRead;
+		mAudioLastRead = now;
+		if (!mAudioClockValid || now - lastRead > AudioClockTimeout)
+		{
+			mAudioResync = true;
+		}
+
+		// Nothing buffered (starting or decoder starved), clock can't be measured
+		int available = mAudioRing->Available();
+		if (available == 0)
+		{
+			return 0;
+		}
+
+		int outRate = mAudioOutputRate;
+		int64_t buffered = (int64_t)(available / channels) * 1000000 / outRate;
+		int64_t due = mAudioWriteEndPts - buffered;
+		int64_t lag = now + mAudioOutputLatency - due;
+
+		int realign = 0;
+		if (mAudioResync || lag > AudioResyncThreshold || lag < -AudioResyncThreshold)
+		{
+			// Early audio is delayed with silence, late audio skips ahead
+			if (lag < -AudioStartThreshold || lag > AudioResyncThreshold)
+			{
+				realign = (int)(-lag * outRate / 1000000);
+			}
+			mAudioLag = 0;
+			mAudioResync = false;
+		}
+		else
+		{
+			mAudioLag = mAudioLag + (lag - mAudioLag) / kSmoothing;
+		}
+		mAudioClockValid = true;
+		return realign;
+	}
+
+	// Consumer: read up to maxFrames interleaved frames to buffer, inserting silence or skipping
+	// frames when the audio clock needs re-aligning
+	int VLCMediaPlayer::ReadAudioFrames(float* buffer, int channels, int maxFrames)
+	{
+		int realign = UpdateAudioClock(channels);
+		int silence = 0;
+		if (realign > 0)
+		{
+			silence = (realign < maxFrames ? realign : maxFrames);
+			memset(buffer, 0, silence * channels * sizeof(float));
+			if (realign > silence)
+			{
+				// Still early, keep re-aligning on the next read
+				mAudioResync = true;
+			}
+		}
+		else if (realign < 0)
+		{
+			// Skip in scratch sized blocks
+			int skip = -realign;
+			while (skip > 0)
+			{
+				int frames = (skip < AudioScratchFrames ? skip : AudioScratchFrames);
+				frames = mAudioRing->Read(mAudioScratch, frames * channels, channels) / channels;
+				if (frames == 0)
+				{
+					break;
+				}
+				skip -= frames;
+			}
+		}
+		return silence + mAudioRing->Read(buffer + silence * channels, (maxFrames - silence) * channels, channels) / channels;
+	}
+
+	// Set the sample rate audio is delivered at and the resampler quality. Applied by the
+	// producer before it next writes to the ring.
+	void VLCMediaPlayer::SetAudioOutputFormat(int sampleRate, eResampleQuality quality)
+	{
+		if (sampleRate <= 0 || quality < ResampleFast || quality >= ResampleQualityCount)
+		{
+			AddMediaEvent(eMPEvent::OnError, eMPError::BadArgument);
+			return;
+		}
+		mAudioOutputRate = sampleRate;
+		mResampleQuality = (int)quality;
+		mAudioFormatChanged = true;
+		DebugLog("VLCMediaPlayer::SetAudioOutputFormat(rate=%d, quality=%d)", sampleRate, quality);
+	}
+
+	// Called by LibVLC before audio playback starts (or when the format changes) to agree
+	// the output format. We accept the native channel count (up to 7.1, libvlc downmixes
+	// anything larger) and rate as 32 bit float samples, the rate is converted to the
+	// output rate by our own resampler.
+	int VLCMediaPlayer::VLCAudioSetupCB(
+		void**		data,		// pointer to data pointer passed to libvlc_audio_set_callbacks() [IN/OUT]
+		char*		format,		// 4 byte sample format [IN/OUT]
+		unsigned*	rate,		// sample rate [IN/OUT]
+		unsigned*	channels)	// channel count [IN/OUT]
+	{
+		VLCMediaPlayer* mp = (VLCMediaPlayer*)*data;
+
+		memcpy(format, "f32l", 4);
+		if (*channels > (unsigned)MaxAudioChannels)
+		{
+			*channels = MaxAudioChannels;
+		}
+
+		// Anything still in the ring is in the old layout
+		mp->mAudioRing->RequestFlush();
+		mp->mAudioChannels = (int)*channels;
+		mp->mAudioInputRate = (int)*rate;
+
+		mp->mNumAudioChannels = (int)*channels;
+		for (int c = 0; c < mp->mNumAudioChannels; c++)
+		{
+			mp->mChannelStereo[c] = (*channels > 1);
+		}
+		mp->mAudioFormatChanged = false;
+		mp->ConfigureResampler();
+
+		DebugLog("VLCMediaPlayer::VLCAudioSetupCB(rate=%d, channels=%d)", *rate, *channels);
+		return 0;
+	}
+
+	// Called by LibVLC when audio playback stops
+	void VLCMediaPlayer::VLCAudioCleanupCB(
+		void*	data)	// data pointer passed to libvlc_audio_set_callbacks() [IN]
+	{
+		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
+		mp->mAudioRing->RequestFlush();
+		mp->mAudioChannels = 0;
+	}
+
 	// When new audio data is available LibVLC calls this function
 	void VLCMediaPlayer::VLCPlayCB(
 		void*		data,		//	data data pointer as passed to libvlc_audio_set_callbacks() [IN]
@@ -366,6 +973,27 @@ namespace FPVR
 		int64_t		pts)		//	expected play time stamp (see libvlc_delay())
 	{
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
+		int channels = mp->mAudioChannels;
+
+		// Output format changed, audio already in the ring is at the old rate
+		if (mp->mAudioFormatChanged.exchange(false))
+		{
+			mp->mAudioRing->RequestFlush();
+			mp->ConfigureResampler();
+		}
+		mp->CorrectAudioDrift();
+
+		const float* src = (const float*)samples;
+		int remaining = (int)count;
+		while (remaining > 0)
+		{
+			int used;
+			int produced = mp->mResampler->Process(src, remaining, mp->mResampleOut, ResampleOutFrames, &used);
+			mp->mAudioRing->Write(mp->mResampleOut, produced * channels, channels);
+			src += used * channels;
+			remaining -= used;
+		}
+		mp->mAudioWriteEndPts = pts + (int64_t)count * 1000000 / mp->mAudioInputRate;
 	}
 
 	// Audio playback should be paused
@@ -374,7 +1002,7 @@ namespace FPVR
 		int64_t	pts)	// time stamp of the pause request(should be elapsed already)
 	{
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
-
+		mp->mAudioPaused = true;
 	}
 
 	// Audio playback should be resumed after pause
@@ -383,6 +1011,7 @@ namespace FPVR
 		int64_t	pts)	// time stamp of the resumption request (should be elapsed already)
 	{
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
+		mp->mAudioPaused = false;
 	}
 
 	// Callback prototype for audio buffer flush (i.e. discard all pending buffers and
@@ -392,14 +1021,24 @@ namespace FPVR
 		int64_t	pts)
 	{
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
+		mp->mAudioRing->RequestFlush();
+		mp->mResampler->Reset();
+		mp->mAudioResync = true;
 	}
 
 	// Callback for audio buffer drain (wait for pending buffers to be played)
 	void VLCMediaPlayer::VLCDrainCB(
 		void*	data)	// pointer as passed to libvlc_audio_set_callbacks() [IN]
 	{
+		static const int kDrainTimeoutMs = 2000;
 		VLCMediaPlayer* mp = (VLCMediaPlayer*)data;
-//?		AddMediaEvent(eMPEvent::AudioDrain);
+
+		// Called on libvlc's audio thread so it is safe to block until Unity has consumed the
+		// ring. Give up if the consumer has stopped reading (eg. Unity audio disabled).
+		for (int waited = 0; mp->mAudioRing->Fill() > 0 && waited < kDrainTimeoutMs; waited += 2)
+		{
+			Sleep(2);
+		}
 	}
 
 	// Fills the specified buffer the available audio data for the channel up to maximum buffer length
@@ -407,40 +1046,136 @@ namespace FPVR
 	// if floatsCopied < maxLength then return value should always be zero
 	int VLCMediaPlayer::RetrieveAudioData(int channel, float* buffer, int maxLength, int* floatsCopied)
 	{
-		*floatsCopied = 0;
-		return 0;
+		// All channels are returned interleaved, while paused buffered audio is kept for resume
+		int channels = mAudioChannels;
+		if (channel != 0 || channels == 0 || mAudioPaused)
+		{
+			*floatsCopied = 0;
+			return 0;
+		}
+
+		int frames = maxLength / channels;
+		int copied = ReadAudioFrames(buffer, channels, frames);
+		if (copied < frames)
+		{
+			mAudioUnderruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		float volume = mVolume;
+		if (volume != 1.0f)
+		{
+			ScaleSamples(buffer, copied * channels, volume);
+		}
+		*floatsCopied = copied * channels;
+		return mAudioRing->Available();
 	}
 
-	// Having specified data source and surface, this function gets ready to play. Once
-	// play starts we should have valid info about the video (readable/playable, width, height
-	// and possibly duration).
-	bool VLCMediaPlayer::PrepareAsync()
+	// Fills a planar buffer with up to maxFrames frames of every channel. Interleaved samples are
+	// read from the ring in scratch sized blocks and split directly into the caller's buffer.
+	int VLCMediaPlayer::RetrieveAudioDataPlanar(float* buffer, int numChannels, int maxFrames, int* framesCopied)
 	{
-		assert(mVLCInstance != nullptr && mVideoPath != nullptr);
-
-		DebugLog("VLCMediaPlayer::PrepareAsync()");
-
-		// Check objects in expected state
-		if (mVLCInstance == nullptr
-			|| mVLCMedia != nullptr
-			|| mVLCMediaPlayer != nullptr)
+		int channels = mAudioChannels;
+		*framesCopied = 0;
+		if (channels == 0 || mAudioPaused || numChannels <= 0)
 		{
-			AddMediaEvent(eMPEvent::OnError, eMPError::IncompatibleState);
-			DebugLog("VLCMediaPlayer::PrepareAsync() IncompatibleState");
-			return false;
+			return 0;
 		}
 
-		// User must have supplied video path and a texture of known format
-		if (mVideoPath == nullptr
-			|| mFrameManager->Format() == eTexFmt::TEXFMT_UNKNOWN)
+		int outChannels = (channels < numChannels ? channels : numChannels);
+		float* planes[MaxAudioChannels];
+		float discard[AudioScratchFrames];
+		for (int c = 0; c < channels; c++)
+		{
+			// Stream channels the caller has no room for are split into a discard buffer
+			planes[c] = (c < outChannels ? buffer + c * maxFrames : discard);
+		}
+
+		float volume = mVolume;
+		int copied = 0;
+		while (copied < maxFrames)
+		{
+			int frames = (maxFrames - copied < AudioScratchFrames ? maxFrames - copied : AudioScratchFrames);
+			frames = (copied == 0 ? ReadAudioFrames(mAudioScratch, channels, frames) : mAudioRing->Read(mAudioScratch, frames * channels, channels) / channels);
+			if (frames == 0)
+			{
+				break;
+			}
+			if (volume != 1.0f)
+			{
+				ScaleSamples(mAudioScratch, frames * channels, volume);
+			}
+			Deinterleave(mAudioScratch, channels, frames, planes);
+			for (int c = 0; c < outChannels; c++)
+			{
+				planes[c] += frames;
+			}
+			copied += frames;
+		}
+
+		// Zero channels not present in the stream
+		for (int c = outChannels; c < numChannels; c++)
+		{
+			memset(buffer + c * maxFrames, 0, copied * sizeof(float));
+		}
+
+		if (copied < maxFrames)
+		{
+			mAudioUnderruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		*framesCopied = copied;
+		return mAudioRing->Available() / channels;
+	}
+
+	// Having specified data source and surface, this function gets ready to play. Once
+	// play starts we should have valid info about the video (readable/playable, width, height
+	// and possibly duration).
+	bool VLCMediaPlayer::PrepareAsync()
+	{
+		assert(mVLCInstance != nullptr && (mVideoPath != nullptr || mMemorySource != nullptr));
+
+		DebugLog("VLCMediaPlayer::PrepareAsync()");
+
+		// Check objects in expected state
+		if (mVLCInstance == nullptr
+			|| mVLCMedia != nullptr
+			|| mVLCMediaPlayer != nullptr)
+		{
+			AddMediaEvent(eMPEvent::OnError, eMPError::IncompatibleState);
+			DebugLog("VLCMediaPlayer::PrepareAsync() IncompatibleState");
+			return false;
+		}
+
+		// User must have supplied video path and a texture of known format
+		if ((mVideoPath == nullptr && mMemorySource == nullptr)
+			|| mFrameManager->Format() == eTexFmt::TEXFMT_UNKNOWN)
 		{
 			DebugLog("VLCMediaPlayer::PrepareAsync() BadArgument");
 			AddMediaEvent(eMPEvent::OnError, eMPError::BadArgument);
 			return false;
 		}
 
+		// If this media has been probed before its info is known straight away and it is reported
+		// as prepared as soon as the input has opened (on playing) rather than once libvlc has
+		// parsed the container. Waiting for the open means media that can no longer be opened
+		// only reports OnError.
+		mPrepareEventPending = true;
+		mHaveMediaInfoKey = MediaInfoCache::MakeKey(mVideoPath, mVideoPathIsURL, mVideoETag, &mMediaInfoKey);
+		if (gMediaInfoCache != nullptr && mHaveMediaInfoKey)
+		{
+			MediaInfo info;
+			if (gMediaInfoCache->Lookup(mMediaInfoKey, &info))
+			{
+				ApplyMediaInfo(info);
+				mPreparedFromCache = true;
+				DebugLog("VLCMediaPlayer::PrepareAsync() using cached media info (w=%d, h=%d, duration=%I64d)", mVideoWidth, mVideoHeight, mVideoDuration);
+			}
+		}
+
 		// Create media object
-		if (mVideoPathIsURL)
+		if (mMemorySource != nullptr)
+		{
+			mVLCMedia = mMemorySource->CreateMedia(mVLCInstance);
+		}
+		else if (mVideoPathIsURL)
 		{
 			mVLCMedia = libvlc_media_new_location(mVLCInstance, mVideoPath);
 		}
@@ -450,6 +1185,22 @@ namespace FPVR
 		}
 		if (mVLCMedia != nullptr)
 		{
+			// Seek to keyframes only while scrubbing
+			if (mScrubMode)
+			{
+				libvlc_media_add_option(mVLCMedia, ":input-fast-seek");
+			}
+			ApplyDecodeOptions(mVLCMedia, mDecodeOptions);
+
+			// Looping media is repeated by the input so the decoders and output are kept
+			mLoopPrepared = mLooping;
+			if (mLoopPrepared)
+			{
+				char option[32];
+				_snprintf_s(option, sizeof(option), _TRUNCATE, ":input-repeat=%d", LoopRepeatCount);
+				libvlc_media_add_option(mVLCMedia, option);
+			}
+
 			AttachMediaEvents();
 
 			// Create media player instance
@@ -463,7 +1214,8 @@ namespace FPVR
 				libvlc_video_set_format(mVLCMediaPlayer, mFrameManager->FourCC(), mFrameManager->Width(), mFrameManager->Height(), mFrameManager->Stride());
 
 				libvlc_audio_set_callbacks(mVLCMediaPlayer, VLCPlayCB, VLCPauseCB, VLCResumeCB, VLCFlushCB, VLCDrainCB, this);
-				libvlc_audio_set_format(mVLCMediaPlayer, "f32l", 48000, 1);
+				libvlc_audio_set_format_callbacks(mVLCMediaPlayer, VLCAudioSetupCB, VLCAudioCleanupCB);
+				ApplyRate();
 
 				// Start playing (this forces player to actually read media)
 				libvlc_media_player_play(mVLCMediaPlayer);
@@ -488,12 +1240,591 @@ namespace FPVR
 	// Update target texture with latest frame (if changed)
 	void VLCMediaPlayer::Render()
 	{
-		mFrameManager->Render();
+		mFrameManager->Render(BeginRender());
+	}
+
+	// Presentation time for this render. When audio is being heard late the frame shown is the
+	// one libvlc wanted shown that long ago, so video follows the audio clock.
+	int64_t VLCMediaPlayer::BeginRender()
+	{
+		int64_t now = libvlc_clock();
+		if (mAudioClockValid && now - mAudioLastRead > AudioClockTimeout)
+		{
+			// Unity has stopped reading audio, let video run from libvlc's clock
+			mAudioClockValid = false;
+		}
+		if (mHudEnabled)
+		{
+			int channels = mAudioChannels;
+			int rate = mAudioOutputRate;
+			mFrameManager->SetHudAudioFill(channels > 0 && rate > 0 ? (int)((int64_t)mAudioRing->Fill() / channels * 1000 / rate) : -1);
+		}
+		return now - GetAVSyncOffset();
+	}
+
+	// Set playback rate, applied now if there is a player otherwise when one is created
+	void VLCMediaPlayer::SetRate(float rate)
+	{
+		if (rate <= 0.0f)
+		{
+			AddMediaEvent(eMPEvent::OnError, eMPError::BadArgument);
+			return;
+		}
+		mPlaybackRate = rate;
+		if (mVLCMediaPlayer != nullptr)
+		{
+			ApplyRate();
+		}
+	}
+
+	// Apply mPlaybackRate to the libvlc player, the position clock extrapolates at the same rate
+	void VLCMediaPlayer::ApplyRate()
+	{
+		if (libvlc_media_player_set_rate(mVLCMediaPlayer, mPlaybackRate) != 0)
+		{
+			DebugLog("VLCMediaPlayer::ApplyRate() rate %.2f not supported", mPlaybackRate);
+			return;
+		}
+		mPlaybackClock->SetRate(mPlaybackRate, libvlc_clock());
+	}
+
+	// Enable or disable the performance HUD
+	void VLCMediaPlayer::SetHudEnabled(bool enable)
+	{
+		mHudEnabled = enable;
+		mFrameManager->SetHudEnabled(enable);
 	}
 
 	// Call every frame to process video events
 	void VLCMediaPlayer::Update()
 	{
+		// Input wrapped after looping was turned off, stop as if the end had been reached
+		if (mLoopStopPending.exchange(false) && mVLCMediaPlayer != nullptr)
+		{
+			libvlc_media_player_stop(mVLCMediaPlayer);
+			mPlaybackClock->SetPaused(true, libvlc_clock());
+			mReachedEnd = true;
+			AddMediaEvent(eMPEvent::OnReachedEnd);
+		}
+
+		// Open the next playlist item paused once the current one is under way, switch to it at
+		// the end of the current one
+		if (mNextPath != nullptr && mNextItem == nullptr && mVLCMediaPlayer != nullptr && mPrepared)
+		{
+			PrerollNextItem();
+		}
+		if (mNextItem != nullptr && mReachedEnd && mPrepared)
+		{
+			StartNextItem();
+		}
+
+		// Media not opened for looping (or repeats exhausted) is restarted
+		else if (mLooping && mReachedEnd && mPrepared)
+		{
+			RecordLoopWrap(libvlc_clock());
+			Play();
+		}
+
+		if (mScrubMode)
+		{
+			UpdateScrub();
+		}
+
+		PublishStatus();
+	}
+
+	// Write current status under the seqlock. Counters are read directly rather than through
+	// GetStats so publishing costs no locks or percentile estimates. Publishing never posts
+	// events (the position is 0 until the media is prepared).
+	void VLCMediaPlayer::PublishStatus()
+	{
+		VFMStats frameStats;
+		mFrameManager->GetCounters(&frameStats);
+		int64_t positionUs = PeekPositionUs();
+
+		BeginStatusWrite(mStatus);
+		mStatus->mState = mState;
+		mStatus->mBufferingPercent = mBufferingPercent;
+		mStatus->mVideoWidth = mVideoWidth;
+		mStatus->mVideoHeight = mVideoHeight;
+		mStatus->mIsSeekable = (mMediaIsSeekable ? 1 : 0);
+		mStatus->mIsPausable = (mMediaIsPausable ? 1 : 0);
+		mStatus->mNumAudioChannels = mNumAudioChannels;
+		mStatus->mIsLooping = (mLooping ? 1 : 0);
+		mStatus->mPosition = positionUs / 1000;
+		mStatus->mPositionUs = positionUs;
+		mStatus->mDuration = mVideoDuration;
+		mStatus->mPublishTime = LatencyHistogram::Now();
+		mStatus->mPublishCount++;
+		mStatus->mFramesDecoded = mFramesDecoded.load(std::memory_order_relaxed);
+		mStatus->mFramesDisplayed = frameStats.mFramesDisplayed;
+		mStatus->mFramesDropped = frameStats.mFramesDropped;
+		mStatus->mFramesRepeated = frameStats.mFramesRepeated;
+		mStatus->mEventOverflows = (mEventQueue != nullptr ? (int64_t)mEventQueue->OverflowCount() : 0);
+		mStatus->mAudioUnderruns = mAudioUnderruns.load(std::memory_order_relaxed);
+		EndStatusWrite(mStatus);
+	}
+
+	// Enable or disable scrubbing
+	void VLCMediaPlayer::SetScrubMode(bool enable, int numDecoders, int64_t spacing)
+	{
+		mScrubMode = enable;
+		mNumScrubDecoders = (!enable || numDecoders < 0 ? 0 : (numDecoders > MaxScrubDecoders ? MaxScrubDecoders : numDecoders));
+		mScrubSpacing = (spacing > 0 ? spacing : 1000);
+
+		// Release decoders no longer wanted, missing ones are created by UpdateScrub
+		for (int i = mNumScrubDecoders; i < MaxScrubDecoders; i++)
+		{
+			if (mScrubDecoders[i] != nullptr)
+			{
+				mScrubDecoders[i]->Release();
+				mScrubDecoders[i] = nullptr;
+			}
+		}
+
+		// Seek to where scrubbing stopped
+		if (!enable && mScrubTargetPending)
+		{
+			mScrubTargetPending = false;
+			StartSeek(mScrubTarget, SeekAccurate);
+		}
+	}
+
+	// Release all secondary decoders
+	void VLCMediaPlayer::ReleaseScrubDecoders()
+	{
+		for (int i = 0; i < MaxScrubDecoders; i++)
+		{
+			if (mScrubDecoders[i] != nullptr)
+			{
+				mScrubDecoders[i]->Release();
+				mScrubDecoders[i] = nullptr;
+			}
+		}
+	}
+
+	// Queue frame held by a parked decoder for display. The copy is made into a pool frame on the
+	// main thread, Render then uploads it like any decoded frame.
+	bool VLCMediaPlayer::ShowScrubFrame(ScrubDecoder* decoder)
+	{
+		VideoFrame* frame = mFrameManager->TryGetFrame();
+		if (frame == nullptr)
+		{
+			return false;
+		}
+		if (!decoder->CopyFrame(frame->Pixels(), mFrameManager->Stride() * mFrameManager->Height()))
+		{
+			mFrameManager->DiscardFrame(frame);
+			return false;
+		}
+		mFrameManager->FlushDisplayFrames();
+		mFrameManager->DisplayFrame(frame, libvlc_clock());
+		return true;
+	}
+
+	// Scrubbing, once per frame: show a parked frame near the cursor, issue the latest seek once the
+	// previous one has completed (or is taking too long) and re-park decoders around the cursor.
+	void VLCMediaPlayer::UpdateScrub()
+	{
+		if (!mPrepared || mVLCMediaPlayer == nullptr)
+		{
+			return;
+		}
+
+		// Secondary decoders open the media by path
+		for (int i = 0; i < mNumScrubDecoders && mVideoPath != nullptr; i++)
+		{
+			if (mScrubDecoders[i] == nullptr)
+			{
+				mScrubDecoders[i] = ScrubDecoder::Create(mVLCInstance, mVideoPath, mVideoPathIsURL,
+					mFrameManager->FourCC(), mFrameManager->Width(), mFrameManager->Height(), mFrameManager->Stride());
+			}
+			if (mScrubDecoders[i] != nullptr)
+			{
+				mScrubDecoders[i]->Update();
+			}
+		}
+
+		if (!mScrubTargetPending)
+		{
+			return;
+		}
+
+		// Show the closest parked frame straight away
+		ScrubDecoder* closest = nullptr;
+		int64_t closestDistance = mScrubSpacing / 2;
+		for (int i = 0; i < mNumScrubDecoders; i++)
+		{
+			ScrubDecoder* sd = mScrubDecoders[i];
+			if (sd != nullptr && sd->HasFrame())
+			{
+				int64_t distance = (sd->FrameTime() > mScrubTarget ? sd->FrameTime() - mScrubTarget : mScrubTarget - sd->FrameTime());
+				if (distance <= closestDistance)
+				{
+					closest = sd;
+					closestDistance = distance;
+				}
+			}
+		}
+		if (closest != nullptr && ShowScrubFrame(closest))
+		{
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			mStats.mScrubDecoderHits++;
+		}
+
+		// Issue the latest seek, anything requested meanwhile has been superseded
+		if (!mSeekPending || libvlc_clock() - mSeekStart > ScrubSeekInterval)
+		{
+			mScrubTargetPending = false;
+			StartSeek(mScrubTarget, SeekFast);
+		}
+
+		// Park decoders at spacing either side of the cursor, moving the decoder furthest away to
+		// any position not already covered
+		for (int n = 0; n < mNumScrubDecoders; n++)
+		{
+			int64_t offset = ((n >> 1) + 1) * mScrubSpacing;
+			int64_t pos = mScrubTarget + ((n & 1) != 0 ? -offset : offset);
+			if (pos < 0 || (mVideoDuration > 0 && pos >= mVideoDuration))
+			{
+				continue;
+			}
+
+			ScrubDecoder* furthest = nullptr;
+			int64_t furthestDistance = -1;
+			bool covered = false;
+			for (int i = 0; i < mNumScrubDecoders && !covered; i++)
+			{
+				ScrubDecoder* sd = mScrubDecoders[i];
+				if (sd == nullptr)
+				{
+					continue;
+				}
+				int64_t park = sd->ParkPosition();
+				covered = ((park > pos ? park - pos : pos - park) <= mScrubSpacing / 2);
+				int64_t distance = (park > mScrubTarget ? park - mScrubTarget : mScrubTarget - park);
+				if (park < 0 || distance > furthestDistance)
+				{
+					furthest = sd;
+					furthestDistance = (park < 0 ? INT64_MAX : distance);
+				}
+			}
+			if (!covered && furthest != nullptr && furthestDistance > ((n >> 1) + 1) * mScrubSpacing + mScrubSpacing / 2)
+			{
+				furthest->Park(pos);
+			}
+		}
+	}
+
+	// Queue media to play when the current media ends (nullptr clears). Replaces any item
+	// already queued, the preroll is started by Update.
+	bool VLCMediaPlayer::SetNextDataSource(const char* path)
+	{
+		ReleasePlaylistItem(mNextItem);
+		mNextItem = nullptr;
+		if (mNextPath != nullptr)
+		{
+			free(mNextPath);
+			mNextPath = nullptr;
+		}
+		if (path != nullptr)
+		{
+			mNextPath = _strdup(path);
+		}
+		DebugLog("VLCMediaPlayer::SetNextDataSource(%s)", (path != nullptr ? path : "null"));
+		return true;
+	}
+
+	// Open the next item on its own libvlc player. It is started paused (libvlc's start-paused
+	// pauses the input on its first frame) so the input, demuxer, decoders and outputs are all
+	// set up and the first frame decoded, its callbacks are routed through the item and dropped
+	// until it is promoted. Frames come from the shared frame pool (same texture format).
+	void VLCMediaPlayer::PrerollNextItem()
+	{
+		sPlaylistItem* item = new sPlaylistItem();
+		item->mOwner = this;
+		item->mPath = mNextPath;
+		item->mIsURL = PathIsURL(mNextPath);
+		item->mMedia = nullptr;
+		item->mMediaPlayer = nullptr;
+		item->mLive = false;
+		item->mHeldFrame = nullptr;
+		item->mAudioChannels = 0;
+		item->mAudioRate = 0;
+		mNextPath = nullptr;
+
+		item->mMedia = (item->mIsURL ? libvlc_media_new_location(mVLCInstance, item->mPath) : libvlc_media_new_path(mVLCInstance, item->mPath));
+		if (item->mMedia != nullptr)
+		{
+			libvlc_media_add_option(item->mMedia, ":start-paused");
+			ApplyDecodeOptions(item->mMedia, mDecodeOptions);
+			item->mMediaPlayer = libvlc_media_player_new_from_media(item->mMedia);
+		}
+		if (item->mMediaPlayer == nullptr)
+		{
+			DebugLog("VLCMediaPlayer::PrerollNextItem(%s) failed", item->mPath);
+			ReleasePlaylistItem(item);
+			AddMediaEvent(eMPEvent::OnError, eMPError::MediaError);
+			return;
+		}
+
+		libvlc_video_set_callbacks(item->mMediaPlayer, ItemLockCB, ItemUnlockCB, ItemDisplayCB, item);
+		libvlc_video_set_format(item->mMediaPlayer, mFrameManager->FourCC(), mFrameManager->Width(), mFrameManager->Height(), mFrameManager->Stride());
+		libvlc_audio_set_callbacks(item->mMediaPlayer, ItemPlayCB, ItemPauseCB, ItemResumeCB, ItemFlushCB, ItemDrainCB, item);
+		libvlc_audio_set_format_callbacks(item->mMediaPlayer, ItemAudioSetupCB, ItemAudioCleanupCB);
+		libvlc_media_player_play(item->mMediaPlayer);
+		mNextItem = item;
+		DebugLog("VLCMediaPlayer::PrerollNextItem(%s)", item->mPath);
+	}
+
+	// Switch to the prerolled item at the end of the current media. The finished player is
+	// released (its last frame stays on the texture), the item's player takes its place and its
+	// callbacks go live, then it is resumed. Main thread only, no libvlc callbacks are running
+	// for the player state while this happens (old player stopped, new player paused).
+	void VLCMediaPlayer::StartNextItem()
+	{
+		sPlaylistItem* item = mNextItem;
+		mNextItem = nullptr;
+		int64_t now = libvlc_clock();
+
+		libvlc_media_player_stop(mVLCMediaPlayer);
+		libvlc_media_player_release(mVLCMediaPlayer);
+		libvlc_media_release(mVLCMedia);
+		ReleasePlaylistItem(mLiveItem);
+
+		mVLCMedia = item->mMedia;
+		mVLCMediaPlayer = item->mMediaPlayer;
+		item->mMedia = nullptr;
+		item->mMediaPlayer = nullptr;
+		mLiveItem = item;
+
+		// Data source is now the item's path
+		if (mVideoPath != nullptr)
+		{
+			free(mVideoPath);
+		}
+		if (mVideoETag != nullptr)
+		{
+			free(mVideoETag);
+			mVideoETag = nullptr;
+		}
+		if (mMemorySource != nullptr)
+		{
+			mMemorySource->Release();
+			mMemorySource = nullptr;
+		}
+		mVideoPath = item->mPath;
+		mVideoPathIsURL = item->mIsURL;
+		item->mPath = nullptr;
+
+		// Per-media state (scrub decoders are re-created for the new media)
+		ReleaseScrubDecoders();
+		mReachedEnd = false;
+		mSeekPending = false;
+		mLoopPrepared = false;
+		mLastReportedTime = 0;
+		mPlaybackClock->Set(0, now);
+		mVideoDuration = -1;
+		mMediaIsSeekable = true;
+		mMediaIsPausable = true;
+		mHaveMediaInfoKey = MediaInfoCache::MakeKey(mVideoPath, mVideoPathIsURL, nullptr, &mMediaInfoKey);
+		mPreparedFromCache = false;
+		mPrepareEventPending = true;
+
+		// The item's audio format was agreed while it was paused
+		if (item->mAudioChannels > 0)
+		{
+			mAudioChannels = item->mAudioChannels;
+			mAudioInputRate = item->mAudioRate;
+			mNumAudioChannels = item->mAudioChannels;
+			for (int c = 0; c < mNumAudioChannels; c++)
+			{
+				mChannelStereo[c] = (item->mAudioChannels > 1);
+			}
+			mAudioFormatChanged = true;
+			mAudioResync = true;
+		}
+
+		// The item's player changed state before its events were attached, so read it once
+		mState = (int)libvlc_media_player_get_state(mVLCMediaPlayer);
+		AttachMediaEvents();
+		AttachMediaPlayerEvents();
+		ApplyRate();
+		if (libvlc_media_is_parsed(mVLCMedia))
+		{
+			unsigned int w = 0, h = 0;
+			libvlc_video_get_size(mVLCMediaPlayer, 0, &w, &h);
+			mVideoWidth = w;
+			mVideoHeight = h;
+			mVideoDuration = libvlc_media_get_duration(mVLCMedia);
+			ReadTrackInfo();
+			StoreMediaInfo();
+
+			// The parsed event may still be in flight, whichever comes first sends OnPrepared
+			if (mPrepareEventPending.exchange(false))
+			{
+				AddMediaEvent(eMPEvent::OnPrepared);
+			}
+		}
+
+		// Show the item's first frame now if it was displayed before the pause took effect
+		item->mLive = true;
+		{
+			std::lock_guard<std::mutex> lock(item->mMutex);
+			if (item->mHeldFrame != nullptr)
+			{
+				mFrameManager->DisplayFrame(item->mHeldFrame, now);
+				UpdateFrameGaps(now);
+				item->mHeldFrame = nullptr;
+			}
+		}
+
+		int64_t switches;
+		{
+			std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+			switches = ++mStats.mItemSwitches;
+		}
+		mItemSwitchTime = now;
+		libvlc_media_player_set_pause(mVLCMediaPlayer, 0);
+		AddMediaEvent(eMPEvent::OnItemChanged, switches);
+		DebugLog("VLCMediaPlayer::StartNextItem(%s)", mVideoPath);
+	}
+
+	// Release a playlist item, stopping its player if it still owns one (main thread)
+	void VLCMediaPlayer::ReleasePlaylistItem(sPlaylistItem* item)
+	{
+		if (item == nullptr)
+		{
+			return;
+		}
+		if (item->mMediaPlayer != nullptr)
+		{
+			libvlc_media_player_stop(item->mMediaPlayer);
+			libvlc_media_player_release(item->mMediaPlayer);
+		}
+		if (item->mMedia != nullptr)
+		{
+			libvlc_media_release(item->mMedia);
+		}
+		if (item->mHeldFrame != nullptr)
+		{
+			mFrameManager->DiscardFrame(item->mHeldFrame);
+		}
+		if (item->mPath != nullptr)
+		{
+			free(item->mPath);
+		}
+		delete item;
+	}
+
+	// Playlist item video callbacks: frames come from the shared pool, until the item is live
+	// the first frame displayed is held for the switch and any others are dropped
+	void* VLCMediaPlayer::ItemLockCB(void* opaque, void** planes)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)opaque;
+		return VLCLockCB(item->mOwner, planes);
+	}
+
+	void VLCMediaPlayer::ItemUnlockCB(void* opaque, void* picture, void*const* planes)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)opaque;
+		if (item->mLive)
+			VLCUnlockCB(item->mOwner, picture, planes);
+	}
+
+	void VLCMediaPlayer::ItemDisplayCB(void* opaque, void* picture)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)opaque;
+		if (item->mLive)
+		{
+			VLCDisplayCB(item->mOwner, picture);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(item->mMutex);
+		if (item->mHeldFrame == nullptr)
+		{
+			item->mHeldFrame = (VideoFrame*)picture;
+		}
+		else
+		{
+			item->mOwner->mFrameManager->DiscardFrame((VideoFrame*)picture);
+		}
+	}
+
+	// Playlist item audio callbacks: the format is recorded while paused (the player's audio
+	// state belongs to the current media), once live everything is passed to the player
+	int VLCMediaPlayer::ItemAudioSetupCB(void** data, char* format, unsigned* rate, unsigned* channels)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)*data;
+		if (item->mLive)
+		{
+			void* mp = item->mOwner;
+			return VLCAudioSetupCB(&mp, format, rate, channels);
+		}
+
+		memcpy(format, "f32l", 4);
+		if (*channels > (unsigned)MaxAudioChannels)
+		{
+			*channels = MaxAudioChannels;
+		}
+		item->mAudioChannels = (int)*channels;
+		item->mAudioRate = (int)*rate;
+		return 0;
+	}
+
+	void VLCMediaPlayer::ItemAudioCleanupCB(void* data)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCAudioCleanupCB(item->mOwner);
+		}
+	}
+
+	void VLCMediaPlayer::ItemPlayCB(void* data, const void* samples, unsigned count, int64_t pts)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCPlayCB(item->mOwner, samples, count, pts);
+		}
+	}
+
+	void VLCMediaPlayer::ItemPauseCB(void* data, int64_t pts)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCPauseCB(item->mOwner, pts);
+		}
+	}
+
+	void VLCMediaPlayer::ItemResumeCB(void* data, int64_t pts)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCResumeCB(item->mOwner, pts);
+		}
+	}
+
+	void VLCMediaPlayer::ItemFlushCB(void* data, int64_t pts)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCFlushCB(item->mOwner, pts);
+		}
+	}
+
+	void VLCMediaPlayer::ItemDrainCB(void* data)
+	{
+		sPlaylistItem* item = (sPlaylistItem*)data;
+		if (item->mLive)
+		{
+			VLCDrainCB(item->mOwner);
+		}
 	}
 
 	// Start playing from current position (if immediately after Prepare then from beginning)
@@ -505,7 +1836,9 @@ namespace FPVR
 			if (mReachedEnd)
 			{
 				libvlc_media_player_set_media(mVLCMediaPlayer, mVLCMedia);
-				mReachedEnd = true;
+				mReachedEnd = false;
+				mLastReportedTime = 0;
+				mPlaybackClock->Set(0, libvlc_clock());
 			}
 			libvlc_media_player_play(mVLCMediaPlayer);
 		}
@@ -528,33 +1861,77 @@ namespace FPVR
 		}
 	}
 
-	// Retrieve current playback position
+	// Retrieve current playback position in milliseconds
 	int64_t VLCMediaPlayer::GetCurrentPosition()
+	{
+		return GetCurrentPositionUs() / 1000;
+	}
+
+	// Retrieve current playback position in microseconds. Read from the interpolated clock rather
+	// than libvlc, which only updates when its input thread ticks and takes the player lock.
+	int64_t VLCMediaPlayer::GetCurrentPositionUs()
+	{
+		if (mVLCMediaPlayer == nullptr || !mPrepared)
+		{
+			AddMediaEvent(eMPEvent::OnError, eMPError::IncompatibleState);
+		}
+		return PeekPositionUs();
+	}
+
+	// Playback position in microseconds without reporting an error (0 if there is no prepared media)
+	int64_t VLCMediaPlayer::PeekPositionUs()
 	{
 		int64_t pos = 0;
 		if (mVLCMediaPlayer != nullptr && mPrepared)
 		{
-			if (mReachedEnd)
+			if (mReachedEnd && mVideoDuration >= 0)
 			{
-				pos = mVideoDuration;
+				pos = mVideoDuration * 1000;
 			}
 			else
 			{
-				pos = libvlc_media_player_get_time(mVLCMediaPlayer);
+				// Clock is paused at the last time reported when the end is reached
+				pos = mPlaybackClock->GetTime(libvlc_clock());
+			}
+		}
+		return pos;
+	}
+
+	// Seek to specified position (if seekable). libvlc 2.2 has no per-seek mode, so both modes
+	// ask libvlc for the time: fast mode completes on whatever frame arrives first (the nearest
+	// keyframe when the media is opened for fast seeking), accurate mode withholds frames until
+	// libvlc reports the target time. Frames queued from before the seek are dropped.
+	void VLCMediaPlayer::SeekTo(int64_t pos, eSeekMode mode)
+	{
+		if (mScrubMode && mVLCMediaPlayer != nullptr && mPrepared)
+		{
+			// Issued by UpdateScrub, a target not yet issued is superseded
+			if (mScrubTargetPending)
+			{
+				std::lock_guard<ProfiledMutex> lock(mStatsMutex);
+				mStats.mScrubSeeksSuperseded++;
 			}
+			mScrubTarget = pos;
+			mScrubTargetPending = true;
 		}
 		else
 		{
-			AddMediaEvent(eMPEvent::OnError, eMPError::IncompatibleState);
+			StartSeek(pos, mode);
 		}
-		return pos;
 	}
 
-	// Seek to specified position (if seekable)
-	void VLCMediaPlayer::SeekTo(int64_t pos)
+	// Issue seek to libvlc
+	void VLCMediaPlayer::StartSeek(int64_t pos, eSeekMode mode)
 	{
 		if (mVLCMediaPlayer != nullptr && mPrepared)
 		{
+			mSeekMode = (int)mode;
+			mSeekTarget = pos * 1000;
+			mSeekStart = libvlc_clock();
+			mSeekTimeReached = false;
+			mSeekPending = true;
+			mFrameManager->FlushDisplayFrames();
+
 			if (mReachedEnd)
 			{
 				mReachedEnd = false;
@@ -562,6 +1939,8 @@ namespace FPVR
 				libvlc_media_player_play(mVLCMediaPlayer);
 			}
 			libvlc_media_player_set_time(mVLCMediaPlayer, pos);
+			mPlaybackClock->Set(pos * 1000, libvlc_clock());
+			mLastReportedTime = pos * 1000;
 		}
 		else
 		{
@@ -575,9 +1954,11 @@ namespace FPVR
 		static const int g_DebugLevelThreshold = LIBVLC_NOTICE;	// LIBVLC_DEBUG
 		VLCMediaPlayer*mp = (VLCMediaPlayer*)data;
 
-		if (level >= g_DebugLevelThreshold)
+		// Notices are per decoder / per stream chatter and only formatted when debug logging is on
+		eLogLevel logLevel = (level >= LIBVLC_ERROR ? LogError : (level >= LIBVLC_WARNING ? LogWarning : LogDebug));
+		if (level >= g_DebugLevelThreshold && FPVR_LOG_ENABLED(logLevel))
 		{
-			DebugLogV(fmt, args);
+			DebugLogAtV(logLevel, fmt, args);
 		}
 	}
 
@@ -588,10 +1969,22 @@ namespace FPVR
 		if (mVLCInstance != nullptr)
 		{
 			mFrameManager = VideoFrameManager::Create(2);
-			if (mFrameManager == nullptr)
+			mAudioRing = AudioRingBuffer::Create(AudioBufferSamples);
+			mEventQueue = MediaEventQueue::Create();
+			mPlaybackClock = PlaybackClock::Create();
+			mStatus = CreateStatusBlock();
+			mAudioScratch = new float[AudioScratchFrames * MaxAudioChannels];
+			mResampler = AudioResampler::Create();
+			mResampleOut = new float[ResampleOutFrames * MaxAudioChannels];
+			if (mFrameManager == nullptr
+				|| mAudioRing == nullptr
+				|| mEventQueue == nullptr
+				|| mPlaybackClock == nullptr
+				|| mStatus == nullptr
+				|| mResampler == nullptr)
 			{
-				libvlc_release(mVLCInstance);
-				mVLCInstance = nullptr;
+				// Releases whatever was created, including the libvlc instance
+				ReleaseResources();
 			}
 		}
 		DebugLog("VLCMediaPlayer::Initialize(): %s", (mVLCInstance != nullptr ? "succeeded" : "failed"));
@@ -611,14 +2004,67 @@ namespace FPVR
 			free(mVideoPath);
 			mVideoPath = nullptr;
 		}
+		if (mVideoETag != nullptr)
+		{
+			free(mVideoETag);
+			mVideoETag = nullptr;
+		}
 		mVideoPathIsURL = false;
 
+		ReleaseResources();
+	}
+
+	// Release the resources allocated by Initialize (any that were not created are skipped)
+	void VLCMediaPlayer::ReleaseResources()
+	{
 		if (mFrameManager != nullptr)
 		{
 			mFrameManager->Release();
 			mFrameManager = nullptr;
 		}
 
+		if (mAudioRing != nullptr)
+		{
+			mAudioRing->Release();
+			mAudioRing = nullptr;
+		}
+
+		if (mEventQueue != nullptr)
+		{
+			mEventQueue->Release();
+			mEventQueue = nullptr;
+		}
+
+		if (mStatus != nullptr)
+		{
+			ReleaseStatusBlock(mStatus);
+			mStatus = nullptr;
+		}
+
+		if (mPlaybackClock != nullptr)
+		{
+			mPlaybackClock->Release();
+			mPlaybackClock = nullptr;
+		}
+
+		if (mAudioScratch != nullptr)
+		{
+			delete[] mAudioScratch;
+			mAudioScratch = nullptr;
+		}
+
+		if (mResampler != nullptr)
+		{
+			mResampler->Release();
+			mResampler = nullptr;
+		}
+
+		if (mResampleOut != nullptr)
+		{
+			delete[] mResampleOut;
+			mResampleOut = nullptr;
+		}
+
 		if (mVLCInstance != nullptr)
 		{
 			libvlc_release(mVLCInstance);
@@ -628,7 +2074,8 @@ namespace FPVR
 
 	// If any of the following function pointers are non-null the function will be
 	// called when the corresponding event occurs.
-	VLCMediaPlayer::VLCMediaPlayer()
+	VLCMediaPlayer::VLCMediaPlayer() :
+		mStatsMutex("VLCMediaPlayer::mStatsMutex")
 	{
 		mVLCInstance = nullptr;
 		mVLCMedia = nullptr;
@@ -637,8 +2084,64 @@ namespace FPVR
 		mPrepared = false;
 		mReachedEnd = false;
 		mHadVideoRenderingStart = false;
+		mPreparedFromCache = false;
+		mPrepareEventPending = false;
+
+		GetDecodePreset(DecodePresetDefault, &mDecodeOptions);
+
+		mScrubMode = false;
+		mNumScrubDecoders = 0;
+		mScrubSpacing = 1000;
+		mScrubTarget = 0;
+		mScrubTargetPending = false;
+		for (int i = 0; i < MaxScrubDecoders; i++)
+		{
+			mScrubDecoders[i] = nullptr;
+		}
+
+		mSeekPending = false;
+		mSeekMode = (int)SeekAccurate;
+		mSeekTarget = 0;
+		mSeekStart = 0;
+		mSeekTimeReached = false;
+
+		mHudEnabled = false;
+		mLooping = false;
+		mLoopPrepared = false;
+		mLoopStopPending = false;
+		mLastReportedTime = 0;
+		mLoopWrapTime = 0;
+		mItemSwitchTime = 0;
+		mNumFrameTimes = 0;
+		memset(&mStats, 0, sizeof(mStats));
+		mFramesDecoded = 0;
+		mBytesConverted = 0;
+		mAudioUnderruns = 0;
 
 		mFrameManager = nullptr;
+		mAudioRing = nullptr;
+		mEventQueue = nullptr;
+		mStatus = nullptr;
+		mBufferingPercent = 0;
+		mState = libvlc_NothingSpecial;
+		mPlaybackClock = nullptr;
+		mAudioPaused = false;
+		mAudioChannels = 0;
+		mAudioScratch = nullptr;
+		mResampler = nullptr;
+		mResampleOut = nullptr;
+		mAudioInputRate = DefaultAudioOutputRate;
+		mAudioOutputRate = DefaultAudioOutputRate;
+		mResampleQuality = (int)ResampleHigh;
+		mAudioFormatChanged = false;
+		mVolume = 1.0f;
+		mPlaybackRate = 1.0f;
+		mAudioWriteEndPts = 0;
+		mAudioOutputLatency = 0;
+		mAudioLag = 0;
+		mAudioLastRead = 0;
+		mAudioClockValid = false;
+		mAudioResync = true;
 
 		mMediaIsSeekable = true;
 		mMediaIsPausable = true;
@@ -653,11 +2156,18 @@ namespace FPVR
 			mChannelStereo[i] = false;
 			mChannelFrequency[i] = 0;
 		}
-		mVideoPath = nullptr;
-		mVideoPathIsURL = false;
+		mNumVideoTracks = -1;
+		mNumAudioTracks = -1;
+		mNumSubtitleTracks = -1;
+		mHaveMediaInfoKey = false;
 
 		mVideoPath = nullptr;
 		mVideoPathIsURL = false;
+		mVideoETag = nullptr;
+		mMemorySource = nullptr;
+		mNextPath = nullptr;
+		mNextItem = nullptr;
+		mLiveItem = nullptr;
 
 		DebugLogS("VLCMediaPlayer::VLCMediaPlayer()");
 	}
@@ -1,13 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
-#include <queue>
 
 #include <vlc/vlc.h>
 
 #include "Unity/IUnityGraphics.h"
 #include "PluginUtils.h"
 #include "VideoFrameManager.h"
+#include "MediaInfoCache.h"
+#include "AudioRingBuffer.h"
+#include "AudioResampler.h"
+#include "MediaEvents.h"
+#include "PlaybackClock.h"
+#include "ScrubDecoder.h"
+#include "DecodeOptions.h"
+#include "MemorySource.h"
+#include "LatencyHistogram.h"
+#include "ProfiledMutex.h"
+#include "PlayerStatus.h"
 #include "VLCMediaPlayer.h"
 
 namespace FPVR
@@ -16,42 +27,74 @@ namespace FPVR
 
 	extern VLCMediaPlayer* gVLCMediaPlayer;
 
-	// Event structure, provides an event and associated context
+	// How SeekTo positions playback
 	typedef enum
 	{
-		NoEvent = 0,
-		OnError = 1,					// An was encountered with an asynchronous operation (param = int error code)
-		OnPrepared = 2,					// Media has been successfully parsed and is ready to play
-		OnVideoRenderingStart = 3,		// First frame of video is ready to display
-		OnPaused = 4,					// Media playback has been paused
-		OnPlaying = 5,					// Media playback has started
-		OnSeekComplete = 6,				// Seek to new position has completed
-		OnReachedEnd = 7,				// Media playback has reached end of media
-		OnBufferingStart = 8,			// Buffering has started
-		OnBufferingProgress = 9,		// New percentage complete for buffering (param = float percentage(
-		OnBufferingEnd = 10,			// Buffering has ended
-		OnPositionChanged = 11			// Regular update on current position when playing
-	} eMPEvent;
-
-	typedef enum
-	{
-		NoError = 0,					// No error has occurred
-		IncompatibleState = 1,			// Call made when player in state where call not allowed
-		BadArgument = 2,				// Call made to function with error in argument(s)
-		InternalError = 3,				// Unexpected error occurred internally
-		MediaError = 4					// Problem occurred reading / processing media
-	} eMPError;
+		SeekFast = 0,					// Show the first frame at or shortly before the requested position (the
+										// nearest keyframe when prepared in scrub mode, which adds :input-fast-seek)
+		SeekAccurate = 1				// Withhold frames until playback reaches the requested position
+	} eSeekMode;
 
+	// Player statistics (times in microseconds). Plain 64 bit fields only so it can be copied
+	// straight into a managed struct, counters run from when the player was created.
 	typedef struct
 	{
-		eMPEvent mMPEvent;
-		int64_t mParam;
-	} MPEvent;
+		int64_t mSeekCount;				// Seeks completed
+		int64_t mLastSeekLatency;		// Time from SeekTo to the first frame after the seek
+		int64_t mMaxSeekLatency;
+		int64_t mTotalSeekLatency;		// Sum of all seek latencies (mean = total / count)
+		int64_t mScrubSeeksSuperseded;	// Scrub seeks replaced by a later one before being issued
+		int64_t mScrubDecoderHits;		// Scrub seeks shown immediately from a parked decoder
+		int64_t mLoopCount;				// Times playback has wrapped to the start in loop mode
+		int64_t mLastLoopGap;			// Longest interval between displayed frames around the last wrap
+		int64_t mMaxLoopGap;
+		int64_t mItemSwitches;			// Times playback moved to the next playlist item
+		int64_t mLastSwitchGap;			// Longest interval between displayed frames around the last switch
+		int64_t mMaxSwitchGap;
+
+		// Video pipeline
+		int64_t mFramesDecoded;			// Frames libvlc delivered for display
+		int64_t mFramesDisplayed;		// Frames copied to the texture
+		int64_t mFramesDropped;			// Frames replaced by a newer frame before they were displayed
+		int64_t mFramesRepeated;		// Renders with no new frame due (the texture kept the previous frame)
+		int64_t mBytesConverted;		// Pixel bytes libvlc wrote into frames
+		int64_t mBytesUploaded;			// Pixel bytes copied to the texture
+		int64_t mPoolFrames;			// Frames in the pool
+		int64_t mFreeFrames;			// Frames ready for libvlc to write
+		int64_t mQueuedFrames;			// Frames waiting for their presentation time
+
+		// Events and audio
+		int64_t mEventQueueDepth;		// Events waiting to be retrieved
+		int64_t mEventOverflows;		// Events dropped because the queue was full
+		int64_t mAudioUnderruns;		// Audio reads that found less audio than requested while playing
+		int64_t mAudioOverflows;		// Audio samples dropped because the ring was full
+
+		// Stage latencies (p50 / p99)
+		int64_t mLockWaitP50;			// Waiting for a free frame in the lock callback
+		int64_t mLockWaitP99;
+		int64_t mConvertP50;			// libvlc writing a frame (lock to unlock)
+		int64_t mConvertP99;
+		int64_t mQueueP50;				// Frame queued to copied to the texture
+		int64_t mQueueP99;
+		int64_t mUploadP50;				// Copying a frame to the texture
+		int64_t mUploadP99;
+		int64_t mEventP50;				// Event added to retrieved
+		int64_t mEventP99;
+	} MPStats;
 
 	class VLCMediaPlayer
 	{
 	public:
 		static const int MaxAudioChannels = 8;
+		static const int AudioBufferSamples = 1 << 18;	// Size of audio ring (~0.7s at 48KHz 7.1, ~2.7s stereo)
+		static const int AudioScratchFrames = 1024;		// Frames de-interleaved per pass by RetrieveAudioDataPlanar
+		static const int ResampleOutFrames = 2048;		// Frames resampled per pass by VLCPlayCB
+		static const int DefaultAudioOutputRate = 48000;
+
+		// Audio master clock tuning (all microseconds)
+		static const int64_t AudioClockTimeout = 250000;	// Audio clock is invalid if Unity hasn't read audio for this long
+		static const int64_t AudioResyncThreshold = 250000;	// Lag beyond which audio is re-aligned rather than corrected
+		static const int64_t AudioStartThreshold = 10000;	// Early audio beyond this is delayed with silence at start
 
 		// ---------------------------------------------------------------------------------------------
 		// Lifecycle management
@@ -69,8 +112,21 @@ namespace FPVR
 		// ---------------------------------------------------------------------------------------------
 		// Setup functions, these must be called prior to calling prepare
 
-		// Set the path to the media to be played
-		bool SetDataSource(const char* path);
+		// Set the path to the media to be played. For URLs an optional ETag identifies the
+		// version of the resource for the media info cache.
+		bool SetDataSource(const char* path, const char* etag = nullptr);
+
+		// Play media from a memory region (which must stay valid until Reset) or from a region
+		// of a pack file (mapped, size 0 = to end of file). libvlc reads the memory directly.
+		// Requires libvlc 3.0 (libvlc_media_new_callbacks), otherwise returns false.
+		bool SetDataSourceMemory(const void* data, uint64_t size);
+		bool SetDataSourcePackFile(const char* path, uint64_t offset, uint64_t size);
+
+		// Queue media (path or URL) to play when the current media ends, nullptr clears. Once the
+		// current media is prepared the next item is opened paused on its first frame by a second
+		// hidden player so the switch is gapless. OnItemChanged is sent when it starts, followed
+		// by OnPrepared once its media info is known. May be called while playing.
+		bool SetNextDataSource(const char* path);
 
 		// Set the surface the media is to be played back to
 		bool SetTexture(void* texture, int width, int height, eTexFmt format);
@@ -97,18 +153,47 @@ namespace FPVR
 		// Returns whether a specific channel is stereo (or not)
 		bool IsAudioChannelStereo(int channel) { return mChannelStereo[channel]; }
 
-		// Returns channel frequency in Hz
+		// Returns channel frequency in Hz (the rate audio is delivered at after resampling)
 		int ChannelFrequency(int channel) { return mChannelFrequency[channel]; }
 
 		// If returns true then retrieves next event, otherwise returns false and mpEvent unchanged
 		bool GetMediaEvent(eMPEvent* mpEvent, int64_t* param);
 
+		// Retrieves up to maxEvents pending events in sequence order, returns number retrieved
+		int GetMediaEvents(MPEvent* mpEvents, int maxEvents);
+
+		// Returns number of events dropped because the event queue was full
+		uint64_t GetMediaEventOverflowCount() { return (mEventQueue != nullptr ? mEventQueue->OverflowCount() : 0); }
+
 		// Fills the specified buffer the available audio data for the channel up to maximum buffer length
 		// Return is number of floats available after number returned. floatsCopied indicates how many were returned
 		// if floatsCopied < maxLength then return value should always be zero
-		// TODO: Change API to optimise, handle synchronisation and flush/drain etc
+		// Lock free, must only be called from one thread (Unity's audio thread).
+		// Samples are interleaved for all channels of the stream, channel must be 0.
 		int RetrieveAudioData(int channel, float* buffer, int maxLength, int* floatsCopied);
 
+		// Fills a planar buffer (numChannels blocks of maxFrames floats) with up to maxFrames frames of
+		// every channel in one call. Channels beyond those in the stream are zero filled. Returns the
+		// number of frames still available, framesCopied indicates how many were returned.
+		// Lock free, must only be called from the same thread as RetrieveAudioData.
+		int RetrieveAudioDataPlanar(float* buffer, int numChannels, int maxFrames, int* framesCopied);
+
+		// Set decode tuning options applied when the media is next prepared
+		void SetDecodeOptions(const DecodeOptions& options) { mDecodeOptions = options; }
+
+		// Set the sample rate audio is delivered at (normally Unity's AudioSettings.outputSampleRate)
+		// and the quality of the resampler used to convert from the decoded rate. Can be changed
+		// during playback, any buffered audio is discarded.
+		void SetAudioOutputFormat(int sampleRate, eResampleQuality quality);
+
+		// Set the latency between audio being retrieved and it being heard (eg. Unity's DSP buffer
+		// length / output rate). Used to align video with the audio actually heard.
+		void SetAudioOutputLatency(int64_t latency) { mAudioOutputLatency = latency; }
+
+		// Returns how late (positive) or early (negative) audio is being heard compared to when libvlc
+		// intended, in microseconds. Video presentation is delayed by this amount. Zero if no audio clock.
+		int64_t GetAVSyncOffset() { return (mAudioClockValid ? (int64_t)mAudioLag : 0); }
+
 		// ---------------------------------------------------------------------------------------------
 		// Playback control
 
@@ -123,17 +208,62 @@ namespace FPVR
 		// Call once per frame from the render thread to update target texture
 		void Render();
 
+		// Render thread: presentation time for this frame's render (follows the audio clock while
+		// audio is being read), also refreshes the HUD. Used with FrameManager() to batch renders.
+		int64_t BeginRender();
+		VideoFrameManager* FrameManager() { return mFrameManager; }
+
 		// Start playing from current position (if immediately after Prepare or after ReachedEnd then from beginning)
 		void Play();
 
 		// Pause video at current position (only meaningful if playing, otherwise ignored or invalid state)
 		void Pause();
 
-		// Retrieve current playback position
+		// Retrieve current playback position in milliseconds. Lock free, interpolated between libvlc's
+		// time reports so may be called from any thread as often as needed.
 		int64_t GetCurrentPosition();
 
-		// Seek to specified position (if seekable) - can be playing or paused
-		void SeekTo(int64_t pos);
+		// Retrieve current playback position in microseconds (as GetCurrentPosition)
+		int64_t GetCurrentPositionUs();
+
+		// Playback position in microseconds, 0 if there is no prepared media. Unlike
+		// GetCurrentPositionUs no error is reported, so it is safe for per frame polling.
+		int64_t PeekPositionUs();
+
+		// Seek to specified position in milliseconds (if seekable) - can be playing or paused.
+		// OnSeekComplete is sent when the first frame after the seek arrives.
+		void SeekTo(int64_t pos, eSeekMode mode = SeekAccurate);
+
+		// Copy current statistics. Each field is read atomically, counters and latencies from
+		// different threads may be a frame apart.
+		void GetStats(MPStats* stats);
+
+		// Enable scrubbing: SeekTo calls are coalesced (a seek superseded before it is issued is
+		// dropped) and use keyframe seeks. Up to numDecoders secondary decoders are parked at
+		// spacing (milliseconds) around the cursor so nearby frames can be shown at once.
+		// Keyframe-only seeking of the main player needs scrub mode enabled before PrepareAsync.
+		void SetScrubMode(bool enable, int numDecoders, int64_t spacing);
+
+		// Loop playback. Enabled before PrepareAsync the input wraps to the start inside libvlc
+		// without rebuilding the decoders, the last frame stays on the texture until the first
+		// frame of the next pass. Enabled later the media is restarted when it reaches the end.
+		void SetLooping(bool loop) { mLooping = loop; }
+		bool IsLooping() { return mLooping; }
+
+		// Set audio volume (1 = unchanged), applied as audio is retrieved so it takes effect at once
+		void SetVolume(float volume) { mVolume = (volume > 0.0f ? volume : 0.0f); }
+		float GetVolume() { return mVolume; }
+
+		// Set playback rate (1 = normal speed). Kept across PrepareAsync and playlist items.
+		void SetRate(float rate);
+		float GetRate() { return mPlaybackRate; }
+
+		// Status block published by Update, valid until the player is released (see PlayerStatus.h)
+		const MPStatus* GetStatusBlock() { return mStatus; }
+
+		// Burn a performance HUD (frame rate, dropped frames, latency, video and audio buffer
+		// fill) into the top left of the video for viewing without a console
+		void SetHudEnabled(bool enable);
 
 	protected:
 		// LibVLC objects
@@ -145,12 +275,111 @@ namespace FPVR
 		bool mPrepared;								// True once media has been parsed
 		bool mReachedEnd;							// True if we have reached the end (cleared once we sort out player)
 		bool mHadVideoRenderingStart;				// True if we have already sent the OnVideoRenderingStart event
+		bool mPreparedFromCache;					// True if media info came from the media info cache
+		std::atomic<bool> mPrepareEventPending;		// True until OnPrepared is sent for the current media
+
+		// Seek tracking (set by SeekTo, completed by the first frame displayed after it)
+		static const int64_t SeekAccurateTolerance = 20000;	// Reported time this close to target counts as reached
+		static const int64_t SeekFastTolerance = 2000000;	// Same for fast seeks, which may land on an earlier keyframe
+		static const int64_t SeekReportWindow = 2000000;	// Reported times further past target are stale
+		static const int64_t SeekTimeout = 3000000;			// Frames are no longer withheld after this long
+		std::atomic<bool> mSeekPending;				// True until first frame after seek is displayed
+		std::atomic<int> mSeekMode;					// eSeekMode of pending seek
+		std::atomic<int64_t> mSeekTarget;			// Target of pending seek (microseconds)
+		std::atomic<int64_t> mSeekStart;			// Time SeekTo was called (libvlc clock)
+		std::atomic<bool> mSeekTimeReached;			// True once libvlc has reported time at the target
+
+		DecodeOptions mDecodeOptions;				// Decode tuning applied as media options on prepare
+		bool mHudEnabled;							// True if the performance HUD is drawn (main thread)
+
+		// Scrubbing (main thread only)
+		static const int MaxScrubDecoders = 4;
+		static const int64_t ScrubSeekInterval = 250000;	// Time a scrub seek may take before it is superseded anyway
+		bool mScrubMode;							// True if seeks are coalesced for scrubbing
+		int mNumScrubDecoders;						// Secondary decoders wanted
+		int64_t mScrubSpacing;						// Distance between parked decoders (milliseconds)
+		int64_t mScrubTarget;						// Latest scrub position requested (milliseconds)
+		bool mScrubTargetPending;					// True if mScrubTarget has not been sought yet
+		ScrubDecoder* mScrubDecoders[MaxScrubDecoders];
+
+		// Looping. With looping enabled at prepare the media is opened with input-repeat so libvlc
+		// seeks back to the start at end of stream, wraps are detected from the reported time
+		// going backwards and the loop gap measured from frame display times around the wrap.
+		static const int LoopRepeatCount = 65535;			// input-repeat count (restarted if ever exhausted)
+		static const int64_t LoopWrapTolerance = 250000;	// Reported time going back further than this is a wrap
+		static const int64_t LoopGapWindow = 500000;		// Frame intervals this close to a wrap count towards the gap
+		static const int LoopFrameHistory = 128;			// Display times kept to measure the gap (power of two)
+		bool mLooping;								// True if playback should loop
+		bool mLoopPrepared;							// True if media was opened with input-repeat
+		std::atomic<bool> mLoopStopPending;			// True if input wrapped with looping disabled (main thread stops)
+		std::atomic<int64_t> mLastReportedTime;		// Last time reported by libvlc (microseconds, event thread)
+		std::atomic<int64_t> mLoopWrapTime;			// Time a wrap was detected (libvlc clock, 0 if none pending)
+		std::atomic<int64_t> mItemSwitchTime;		// Time of last playlist item switch (libvlc clock, 0 if none pending)
+		int64_t mFrameTimes[LoopFrameHistory];		// Recent frame display times (video thread)
+		unsigned int mNumFrameTimes;				// Frame display times recorded
+
+		// Playlist item opened on its own libvlc player ahead of being played. Its callbacks are
+		// routed through the item and only reach the player once it is live.
+		typedef struct
+		{
+			VLCMediaPlayer* mOwner;					// Player the item belongs to
+			char* mPath;							// Path or URL (moved to mVideoPath when started)
+			bool mIsURL;
+			libvlc_media_t* mMedia;					// Media and player (moved to the player when started)
+			libvlc_media_player_t* mMediaPlayer;
+			std::atomic<bool> mLive;				// True once the item is the current media
+			std::mutex mMutex;						// Protects mHeldFrame
+			VideoFrame* mHeldFrame;					// First frame displayed while paused (nullptr if none)
+			int mAudioChannels;						// Audio format agreed while paused (0 if none)
+			int mAudioRate;
+		} sPlaylistItem;
+		char* mNextPath;							// Next item waiting to be prerolled (main thread)
+		sPlaylistItem* mNextItem;					// Next item being prerolled (main thread)
+		sPlaylistItem* mLiveItem;					// Item the current player came from (nullptr if from PrepareAsync)
+
+		ProfiledMutex mStatsMutex;					// Protects mStats
+		MPStats mStats;								// Statistics
+
+		// Pipeline statistics, updated lock free by the thread doing the work
+		std::atomic<int64_t> mFramesDecoded;
+		std::atomic<int64_t> mBytesConverted;
+		std::atomic<int64_t> mAudioUnderruns;
+		LatencyHistogram mLockWaitLatency;			// Lock callback waiting for a free frame
+		LatencyHistogram mConvertLatency;			// Lock to unlock
+		LatencyHistogram mEventLatency;				// Event added to retrieved
 
 		// Management objects
 		VideoFrameManager* mFrameManager;			// Video frame manager
 
-		std::mutex mEventQueueMutex;				// Mutex to make event queue thread safe
-		std::queue<MPEvent> mEventQueue;			// Queue of video events
+		AudioRingBuffer* mAudioRing;				// Decoded audio waiting to be retrieved by Unity (interleaved)
+		std::atomic<bool> mAudioPaused;				// True while libvlc has paused audio output
+		std::atomic<int> mAudioChannels;			// Channels in audio ring (0 until libvlc has set up audio)
+		float* mAudioScratch;						// Consumer scratch for de-interleaving (AudioScratchFrames * MaxAudioChannels)
+
+		AudioResampler* mResampler;					// Converts decoded rate to output rate (producer only)
+		float* mResampleOut;						// Producer scratch for resampled audio (ResampleOutFrames * MaxAudioChannels)
+		int mAudioInputRate;						// Decoded sample rate (producer only)
+		std::atomic<int> mAudioOutputRate;			// Requested output sample rate
+		std::atomic<int> mResampleQuality;			// Requested resampler quality (eResampleQuality)
+		std::atomic<bool> mAudioFormatChanged;		// True if producer must reconfigure the resampler
+		std::atomic<float> mVolume;					// Gain applied to retrieved audio
+		float mPlaybackRate;						// Rate requested by SetRate (main thread)
+
+		// Audio master clock. libvlc passes each audio block the (libvlc clock) time it should be heard,
+		// comparing that with when the consumer actually reads it (plus output latency) gives the
+		// audio lag which drives video presentation and the resampler drift correction.
+		std::atomic<int64_t> mAudioWriteEndPts;	// Time the end of the last block written should be heard (producer)
+		std::atomic<int64_t> mAudioOutputLatency;	// Latency from retrieval to being heard
+		std::atomic<int64_t> mAudioLag;				// Smoothed lag of audio heard behind libvlc's intent (consumer)
+		std::atomic<int64_t> mAudioLastRead;		// Time consumer last read audio
+		std::atomic<bool> mAudioClockValid;			// True while consumer is reading audio regularly
+		std::atomic<bool> mAudioResync;				// True if consumer must re-align audio (start / after flush)
+
+		MediaEventQueue* mEventQueue;				// Lock-free queue of media events (read by main thread)
+		MPStatus* mStatus;							// Status published for reading without calls (written by main thread)
+		std::atomic<int> mBufferingPercent;			// Last buffering progress reported (event thread)
+		std::atomic<int> mState;					// libvlc_state_t tracked from state change events (event thread)
+		PlaybackClock* mPlaybackClock;				// Position interpolated from libvlc's time reports
 
 		// General media information
 		bool mMediaIsSeekable;						// True if media is thought to be seekable, false if known not to be
@@ -166,9 +395,20 @@ namespace FPVR
 		bool mChannelStereo[MaxAudioChannels];		// For each channel true if stereo, otherwise mono
 		int mChannelFrequency[MaxAudioChannels];	// For each channel sample frequency in Hz
 
+		// Track layout
+		int mNumVideoTracks;						// Number of video tracks (-1 if unknown)
+		int mNumAudioTracks;						// Number of audio tracks (-1 if unknown)
+		int mNumSubtitleTracks;						// Number of subtitle tracks (-1 if unknown)
+
+		// Media info cache
+		MediaInfoKey mMediaInfoKey;					// Key of current media in the media info cache
+		bool mHaveMediaInfoKey;						// True if mMediaInfoKey is valid
+
 		// User supplied state
 		char* mVideoPath;							// Path for video we're to play
 		bool mVideoPathIsURL;						// True if path is a URL (ie contains a recognised scheme:)
+		MemorySource* mMemorySource;				// Media data in memory (used instead of mVideoPath)
+		char* mVideoETag;							// Optional ETag for URL (nullptr if none)
 
 		// Add a media player event to the queue
 		void AddMediaEvent(eMPEvent newEvent, int64_t param);
@@ -178,9 +418,66 @@ namespace FPVR
 		void AddMediaEvent(eMPEvent newEvent, float param) { AddMediaEvent(newEvent, (int64_t)(*((int*)&param))); }
 		void AddMediaEvent(eMPEvent newEvent, int param1, int param2) { AddMediaEvent(newEvent, ((int64_t)param1) | (((int64_t)param2) << 32)); }
 
+		// Configure resampler for current input format and requested output format (producer only)
+		void ConfigureResampler();
+
+		// Producer: adjust resampling ratio to correct drift between libvlc's clock and Unity's audio clock
+		void CorrectAudioDrift();
+
+		// Consumer: update audio clock, returns number of frames of silence to insert (or negative
+		// number of frames to skip) to re-align audio when it is far from libvlc's intent
+		int UpdateAudioClock(int channels);
+
+		// Consumer: read up to maxFrames interleaved frames to buffer applying any re-alignment
+		int ReadAudioFrames(float* buffer, int channels, int maxFrames);
+
 		// Clear the media event queue
 		void ClearMediaEvents();
 
+		// Send OnSeekComplete and record seek latency (video thread)
+		void CompleteSeek(int64_t now);
+
+		// Replace the data source with a memory source (takes ownership, null on failure)
+		bool SetMemorySource(MemorySource* source);
+
+		// Count a wrap to the start of the media and start measuring its gap
+		void RecordLoopWrap(int64_t now);
+
+		// Record frame display time and measure loop / item switch gaps once their window has
+		// passed (video thread)
+		void UpdateFrameGaps(int64_t now);
+
+		// Apply mPlaybackRate to the libvlc player and position clock (main thread)
+		void ApplyRate();
+
+		// Write current status to mStatus (main thread)
+		void PublishStatus();
+		int64_t MaxFrameInterval(int64_t time);
+
+		// Playlist: open the next item paused, switch to it, release an item (main thread)
+		void PrerollNextItem();
+		void StartNextItem();
+		void ReleasePlaylistItem(sPlaylistItem* item);
+
+		// Issue seek to libvlc (SeekTo without scrub coalescing)
+		void StartSeek(int64_t pos, eSeekMode mode);
+
+		// Scrubbing: issue coalesced seek, show parked frames, re-park decoders (main thread)
+		void UpdateScrub();
+		void ReleaseScrubDecoders();
+
+		// Queue frame held by a parked decoder for display, returns false if no pool frame is free
+		bool ShowScrubFrame(ScrubDecoder* decoder);
+
+		// Read track layout and audio format of parsed media
+		void ReadTrackInfo();
+
+		// Apply media info (from the cache) to the player state
+		void ApplyMediaInfo(const MediaInfo& info);
+
+		// Write current media info to the media info cache
+		void StoreMediaInfo();
+
 		void AttachMediaEvents();
 		void AttachMediaPlayerEvents();
 
@@ -191,6 +488,22 @@ namespace FPVR
 		static void VLCUnlockCB(void* opaque, void* picture, void*const* planes);
 		static void VLCDisplayCB(void* opaque, void* picture);
 
+		// Call backs from a playlist item's player (passed to the player once the item is live)
+		static void* ItemLockCB(void* opaque, void** planes);
+		static void ItemUnlockCB(void* opaque, void* picture, void*const* planes);
+		static void ItemDisplayCB(void* opaque, void* picture);
+		static int ItemAudioSetupCB(void** data, char* format, unsigned* rate, unsigned* channels);
+		static void ItemAudioCleanupCB(void* data);
+		static void ItemPlayCB(void* data, const void* samples, unsigned count, int64_t pts);
+		static void ItemPauseCB(void* data, int64_t pts);
+		static void ItemResumeCB(void* data, int64_t pts);
+		static void ItemFlushCB(void* data, int64_t pts);
+		static void ItemDrainCB(void* data);
+
+		// Callbacks from VLC audio playback to choose output format
+		static int VLCAudioSetupCB(void** data, char* format, unsigned* rate, unsigned* channels);
+		static void VLCAudioCleanupCB(void* data);
+
 		// Callbacks from VLC audio playback to write to audio buffers
 		static void VLCPlayCB(void* data, const void* samples,	unsigned count, int64_t pts);
 		static void VLCPauseCB(void* data, int64_t pts);
@@ -207,6 +520,9 @@ namespace FPVR
 		// Release any resources allocated during Initialize
 		void Shutdown();
 
+		// Release the resources Initialize allocated (Shutdown, or Initialize when it fails)
+		void ReleaseResources();
+
 		VLCMediaPlayer();
 		~VLCMediaPlayer();
 	};
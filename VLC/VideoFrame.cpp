@@ -2,6 +2,7 @@
 
 #include "UnityPlugin.h"
 #include "PluginUtils.h"
+#include "Trace.h"
 #include "VideoFrame.h"
 
 // ---------------------------------------------------------------------------
@@ -66,6 +67,7 @@ namespace FPVR
 	// Copy this frame to specified target texture
 	void VideoFrame::CopyTo(void* dstTex)
 	{
+		FPVR_TRACE_SCOPE("VideoFrame::CopyTo");
 		UnityPlugin::D3D11Context()->CopyResource((ID3D11Resource*)dstTex, (ID3D11Texture2D*)mTexture);
 		//DebugLog("VideoFrame::CopyTo(dstTex=%08x)", dstTex);
 	}
@@ -111,7 +113,7 @@ namespace FPVR
 			mHeight = height;
 			mFormat = format;
 		}
-		DebugLog("VideoFrame::Initialize(width=%d, height=%d, format=%d) returns %s (hr=%08x)", width, height, format, (width != 0 ? "true" : "false"), hr);
+		FPVR_LOG_DEBUG("VideoFrame::Initialize(width=%d, height=%d, format=%d) returns %s (hr=%08x)", width, height, format, (width != 0 ? "true" : "false"), hr);
 		return (mWidth != 0);
 	}
 
@@ -131,7 +133,7 @@ namespace FPVR
 		mHeight = 0;
 		mFormat = 0;
 
-		DebugLog("VideoFrame::Release()");
+		FPVR_LOG_DEBUG("VideoFrame::Release()");
 
 		delete this;
 	}
@@ -145,8 +147,9 @@ namespace FPVR
 		mTexture = nullptr;
 		mData = nullptr;
 		mRowPitch = 0;
+		mLockTime = 0;
 
-		DebugLog("VideoFrame::VideoFrame()");
+		FPVR_LOG_DEBUG("VideoFrame::VideoFrame()");
 	}
 
 	// Destructor just makes sure we've been shutdown
@@ -155,6 +158,6 @@ namespace FPVR
 		assert(mTexture == nullptr);
 		assert(!IsLocked());
 
-		DebugLog("VideoFrame::~VideoFrame()");
+		FPVR_LOG_DEBUG("VideoFrame::~VideoFrame()");
 	}
 }
@@ -20,6 +20,7 @@ namespace FPVR
 		void*	mTexture;		// Native texture pointer
 		void*	mData;			// If mapped then pointer to memory
 		int		mRowPitch;		// If mapped then pitch
+		int64_t	mLockTime;		// Time the decoder locked the frame for writing
 
 		// Initialise underlying resources
 		bool Initialize(int width, int height, eTexFmt format);
@@ -47,6 +48,13 @@ namespace FPVR
 		// Pitch for frame row (valid when locked)
 		int RowPitch() const { return mRowPitch; }
 
+		// Time the decoder locked the frame for writing (LatencyHistogram::Now() units)
+		int64_t LockTime() const { return mLockTime; }
+		void SetLockTime(int64_t time) { mLockTime = time; }
+
+		// Size of the frame's pixels in bytes
+		int64_t DataSize() const { return (int64_t)mWidth * mHeight * (GetTexFmtBPP((eTexFmt)mFormat) >> 3); }
+
 		// Create a video frame object with specified config
 		static VideoFrame* Create(int width, int height, eTexFmt format);
 
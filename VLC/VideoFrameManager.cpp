@@ -4,10 +4,13 @@
 // Manages a pool of video frames and the next frame to display
 
 #include <cassert>
+#include <cstring>
 
 #include "VideoFrameManager.h"
 #include "VideoFrame.h"
 #include "PluginUtils.h"
+#include "PerfHud.h"
+#include "Trace.h"
 #include "UnityPlugin.h"
 
 namespace FPVR
@@ -16,7 +19,7 @@ namespace FPVR
 	{
 		//DebugLog("VideoFrameManager::SetTarget(width=%d, height=%d, format=%d)", width, height, unityFormat);
 	
-		std::lock_guard<std::mutex> lock(mMutex);
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 
 		// If any of format, width or height have changed then clear free list
 		if (texFmt != mTexFmt
@@ -31,13 +34,16 @@ namespace FPVR
 			MoveListToRelease(mFreeFrames);
 			MoveListToRelease(mPendingFrames);
 
-			// If there's a display frame then release that too
-			if (mDisplayFrame != nullptr)
+			// If there are display frames then release those too
+			std::list<sQueuedFrame>::iterator it;
+			for (it = mDisplayFrames.begin(); it != mDisplayFrames.end(); it++)
 			{
-				mAllocatedFrames.remove(mDisplayFrame);
-				mReleaseFrames.push_back(mDisplayFrame);
-				mDisplayFrame = nullptr;
+				mAllocatedFrames.remove(it->mFrame);
+				mReleaseFrames.push_back(it->mFrame);
 			}
+			mDisplayFrames.clear();
+			UpdateNextDueTime();
+			mNeedsRecycle = true;
 
 			// That may leave us with one or more frames on the allocated frame list
 			// which might be being written to by some other thread, theoretically those
@@ -107,7 +113,7 @@ namespace FPVR
 		assert(mTexture != nullptr);
 
 		VideoFrame* vf = nullptr;
-		std::lock_guard<std::mutex> lock(mMutex);
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 
 		// If list isn't empty then grab first frame on list
 		if (!mFreeFrames.empty())
@@ -116,6 +122,11 @@ namespace FPVR
 			mFreeFrames.pop_front();
 			mAllocatedFrames.push_back(vf);
 		}
+		else
+		{
+			// Let the render thread know the pool may need to grow
+			mNeedsRecycle = true;
+		}
 
 		return vf;
 	}
@@ -138,11 +149,11 @@ namespace FPVR
 		}
 	}
 
-	// Set specified frame as next frame to display
-	void VideoFrameManager::DisplayFrame(VideoFrame* videoFrame)
+	// Queue specified frame to be displayed at (libvlc clock) time
+	void VideoFrameManager::DisplayFrame(VideoFrame* videoFrame, int64_t displayTime)
 	{
-		//DebugLog("VideoFrameManager::DisplayFrame(%08x) DP:%s", videoFrame, (mDisplayFrame != nullptr ? "free" : "null"));
-		std::lock_guard<std::mutex> lock(mMutex);
+		//DebugLog("VideoFrameManager::DisplayFrame(%08x) queued:%d", videoFrame, (int)mDisplayFrames.size());
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 		assert(ListContains(mAllocatedFrames, videoFrame));
 
 		// If the format doesn't match then shove it on the pending list to sort out later. We can't release
@@ -152,28 +163,85 @@ namespace FPVR
 		{
 			mAllocatedFrames.remove(videoFrame);
 			mPendingFrames.push_back(videoFrame);
+			mNeedsRecycle = true;
 		}
 		else
 		{
-			// If there was already a display frame then move it to the free frame list as it was never unlocked / rendered
-			if (mDisplayFrame != nullptr)
+			// If too many frames are waiting then drop the oldest, it goes back on the free frame
+			// list as it was never unlocked / rendered
+			if (mDisplayFrames.size() >= MaxQueuedFrames)
 			{
-				mAllocatedFrames.remove(mDisplayFrame);
-				mFreeFrames.push_back(mDisplayFrame);
+				VideoFrame* oldest = mDisplayFrames.front().mFrame;
+				mDisplayFrames.pop_front();
+				mAllocatedFrames.remove(oldest);
+				mFreeFrames.push_back(oldest);
+				mFramesDropped.fetch_add(1, std::memory_order_relaxed);
 			}
 
-			// Got new display frame
-			mDisplayFrame = videoFrame;
+			sQueuedFrame queued;
+			queued.mFrame = videoFrame;
+			queued.mTime = displayTime;
+			queued.mQueuedAt = LatencyHistogram::Now();
+			mDisplayFrames.push_back(queued);
+			mFramesQueued.fetch_add(1, std::memory_order_relaxed);
+			UpdateNextDueTime();
 		}
 	}
 
-	// Retrieves current display frame
-	VideoFrame* VideoFrameManager::GrabDisplayFrame()
+	// Return a filled frame to the free list without displaying it (it was never unlocked)
+	void VideoFrameManager::DiscardFrame(VideoFrame* videoFrame)
+	{
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		assert(ListContains(mAllocatedFrames, videoFrame));
+		mAllocatedFrames.remove(videoFrame);
+		mFreeFrames.push_back(videoFrame);
+	}
+
+	// Drop all frames waiting to be displayed, they go back on the free list
+	void VideoFrameManager::FlushDisplayFrames()
+	{
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		while (!mDisplayFrames.empty())
+		{
+			VideoFrame* frame = mDisplayFrames.front().mFrame;
+			mDisplayFrames.pop_front();
+			mAllocatedFrames.remove(frame);
+			mFreeFrames.push_back(frame);
+		}
+		UpdateNextDueTime();
+	}
+
+	// Publish the time the oldest display frame is due for NeedsRender (mutex held)
+	void VideoFrameManager::UpdateNextDueTime()
+	{
+		mNextDueTime.store(mDisplayFrames.empty() ? INT64_MAX : mDisplayFrames.front().mTime, std::memory_order_release);
+	}
+
+	// Retrieves the newest display frame due at presentTime, earlier frames that are also due
+	// are skipped and go back on the free list
+	VideoFrame* VideoFrameManager::GrabDisplayFrame(int64_t presentTime, int64_t* queuedAt)
 	{
-		//DebugLog("VideoFrameManager::GrabDisplayFrame() %08x", mDisplayFrame);
-		std::lock_guard<std::mutex> lock(mMutex);
-		VideoFrame* frame = mDisplayFrame;
-		mDisplayFrame = nullptr;
+		//DebugLog("VideoFrameManager::GrabDisplayFrame() queued:%d", (int)mDisplayFrames.size());
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		VideoFrame* frame = nullptr;
+		*queuedAt = 0;
+		while (!mDisplayFrames.empty() && mDisplayFrames.front().mTime <= presentTime)
+		{
+			if (frame != nullptr)
+			{
+				mAllocatedFrames.remove(frame);
+				mFreeFrames.push_back(frame);
+				mFramesDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			frame = mDisplayFrames.front().mFrame;
+			*queuedAt = mDisplayFrames.front().mQueuedAt;
+			mDisplayFrames.pop_front();
+		}
+		if (frame != nullptr)
+		{
+			mQueueLatency.AddSince(*queuedAt);
+			UpdateNextDueTime();
+		}
 		return frame;
 	}
 
@@ -181,16 +249,18 @@ namespace FPVR
 	void VideoFrameManager::MoveAllocatedToPending(VideoFrame* videoFrame)
 	{
 		//DebugLog("VideoFrameManager::MoveToPending(%08x)", videoFrame);
-		std::lock_guard<std::mutex> lock(mMutex);
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 		assert(ListContains(mAllocatedFrames, videoFrame));
 		mAllocatedFrames.remove(videoFrame);
 		mPendingFrames.push_back(videoFrame);
+		mNeedsRecycle = true;
 	}
 
 	// Release previous allocated video frame
 	void VideoFrameManager::MovePendingToFree()
 	{
-		std::lock_guard<std::mutex> lock(mMutex);
+		FPVR_TRACE_SCOPE("VideoFrameManager::MovePendingToFree");
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 
 		while(!mPendingFrames.empty() && mPendingFrames.front()->TryLock())
 		{
@@ -203,7 +273,7 @@ namespace FPVR
 	// Add a new frame to the free list
 	void VideoFrameManager::AddFrameToFree(VideoFrame* videoFrame)
 	{
-		std::lock_guard<std::mutex> lock(mMutex);
+		std::lock_guard<ProfiledMutex> lock(mMutex);
 		mFreeFrames.push_back(videoFrame);
 	}
 
@@ -243,17 +313,39 @@ namespace FPVR
 	}
 
 	// Moves pending frames to free list once they can be locked. Ensures we have
-	// at least one frame on the free list and then renders current display frame
-	// (if there is one) and transfers it to pending list.
-	void VideoFrameManager::Render()
+	// at least one frame on the free list and then renders the display frame due at
+	// presentTime (if there is one) and transfers it to pending list.
+	void VideoFrameManager::Render(int64_t presentTime)
 	{
+		FPVR_TRACE_SCOPE("VideoFrameManager::Render");
+		RecycleFrames();
+		UploadFrame(presentTime);
+	}
+
+	// True if there is a display frame due at presentTime or frames to recycle. Lock free, a
+	// change being made on another thread is seen by the next render at the latest.
+	bool VideoFrameManager::NeedsRender(int64_t presentTime) const
+	{
+		return mNeedsRecycle.load(std::memory_order_acquire) || mNextDueTime.load(std::memory_order_acquire) <= presentTime;
+	}
+
+	// Release frames from an old target, move pending frames that can be locked to the free list
+	// and grow the pool if it has run dry
+	void VideoFrameManager::RecycleFrames()
+	{
+		{
+			std::lock_guard<ProfiledMutex> lock(mMutex);
+			ClearFrameList(mReleaseFrames);
+		}
+
 		if (mTexture != nullptr)
 		{
 			// Try to lock pending textures and move them to free list
 			MovePendingToFree();
 
 			// We need at least two frames and at least one of them free, add frames until we have what we need
-			while (mNumBuffers < 2 || mFreeFrames.empty())
+			// (frames waiting for their presentation time don't count towards the limit)
+			while (mNumBuffers < 2 || (mFreeFrames.empty() && mNumBuffers < mPoolSize + MaxQueuedFrames))
 			{
 				VideoFrame* vf = NewFrame();
 				if (vf != nullptr)
@@ -266,19 +358,112 @@ namespace FPVR
 					break;
 				}
 			}
+		}
 
-			VideoFrame* frame = GrabDisplayFrame();
-			if (frame != nullptr)
+		// Stay dirty while frames are still pending (the GPU hasn't finished with them) or none are free
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		mNeedsRecycle = (!mPendingFrames.empty() || !mReleaseFrames.empty() || mFreeFrames.empty());
+	}
+
+	// Copy the newest display frame due at presentTime to the target
+	void VideoFrameManager::UploadFrame(int64_t presentTime)
+	{
+		if (mTexture == nullptr)
+		{
+			return;
+		}
+
+		int64_t queuedAt;
+		VideoFrame* frame = GrabDisplayFrame(presentTime, &queuedAt);
+		if (frame != nullptr)
+		{
+			FillTextureFromCode(frame->Width() / 4, frame->Height() / 4, frame->RowPitch(), (unsigned char*)frame->Pixels());
+			if (mHudEnabled.load(std::memory_order_relaxed))
 			{
-				FillTextureFromCode(frame->Width() / 4, frame->Height() / 4, frame->RowPitch(), (unsigned char*)frame->Pixels());
-				frame->Unlock();
-				frame->CopyTo(mTexture);
-				MoveAllocatedToPending(frame);
+				DrawFrameHud(frame, LatencyHistogram::Now(), queuedAt);
 			}
+			frame->Unlock();
+			int64_t start = LatencyHistogram::Now();
+			frame->CopyTo(mTexture);
+			mUploadLatency.AddSince(start);
+			mFramesDisplayed.fetch_add(1, std::memory_order_relaxed);
+			mBytesUploaded.fetch_add(frame->DataSize(), std::memory_order_relaxed);
+			MoveAllocatedToPending(frame);
 		}
+		else if (mFramesDisplayed.load(std::memory_order_relaxed) != 0)
+		{
+			mFramesRepeated.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
 
-		std::lock_guard<std::mutex> lock(mMutex);
-		ClearFrameList(mReleaseFrames);
+	// Draw the HUD into a frame while it is still locked. Frame rate is averaged over
+	// HudFpsInterval, latency is this frame's time from being queued to now.
+	void VideoFrameManager::DrawFrameHud(VideoFrame* frame, int64_t now, int64_t queuedAt)
+	{
+		mHudWindowFrames++;
+		if (mHudWindowStart == 0)
+		{
+			mHudWindowStart = now;
+		}
+		else if (now - mHudWindowStart >= HudFpsInterval)
+		{
+			mHudFps = (float)mHudWindowFrames * 1000000.0f / (float)(now - mHudWindowStart);
+			mHudWindowStart = now;
+			mHudWindowFrames = 0;
+		}
+
+		// Frame formats are gTexFmtInfo indices, the pixel layout is the FourCC libvlc decodes to.
+		// Both 32 bit layouts it is given ("RGBA" and "BGRA") keep alpha in byte 3.
+		eTexFmt format = (eTexFmt)frame->Format();
+		const char* fourCC = GetTexFmtFourCC(format);
+		if (GetTexFmtBPP(format) != 32
+			|| (strcmp(fourCC, "RGBA") != 0 && strcmp(fourCC, "BGRA") != 0))
+		{
+			return;
+		}
+		uint32_t alphaMask = 0xFF000000;
+
+		size_t queued;
+		{
+			std::lock_guard<ProfiledMutex> lock(mMutex);
+			queued = mDisplayFrames.size();
+		}
+
+		char text[5][HudMaxChars + 1];
+		_snprintf_s(text[0], sizeof(text[0]), _TRUNCATE, "FPS %.1f", mHudFps);
+		_snprintf_s(text[1], sizeof(text[1]), _TRUNCATE, "DROP %I64d", mFramesDropped.load(std::memory_order_relaxed));
+		_snprintf_s(text[2], sizeof(text[2]), _TRUNCATE, "LAT %.1f MS", (float)(now - queuedAt) / 1000.0f);
+		_snprintf_s(text[3], sizeof(text[3]), _TRUNCATE, "BUF %d/%d", (int)queued, MaxQueuedFrames);
+		int audioFill = mHudAudioFill;
+		_snprintf_s(text[4], sizeof(text[4]), _TRUNCATE, "AUD %d MS", audioFill);
+		const char* lines[5] = { text[0], text[1], text[2], text[3], text[4] };
+
+		DrawHud(frame->Pixels(), frame->RowPitch(), frame->Width(), frame->Height(), alphaMask, lines, (audioFill >= 0 ? 5 : 4));
+	}
+
+	// Copy just the frame and byte counters
+	void VideoFrameManager::GetCounters(VFMStats* stats)
+	{
+		stats->mFramesQueued = mFramesQueued.load(std::memory_order_relaxed);
+		stats->mFramesDisplayed = mFramesDisplayed.load(std::memory_order_relaxed);
+		stats->mFramesDropped = mFramesDropped.load(std::memory_order_relaxed);
+		stats->mFramesRepeated = mFramesRepeated.load(std::memory_order_relaxed);
+		stats->mBytesUploaded = mBytesUploaded.load(std::memory_order_relaxed);
+	}
+
+	// Copy frame counters, pool depth and stage latencies
+	void VideoFrameManager::GetStats(VFMStats* stats)
+	{
+		GetCounters(stats);
+		stats->mQueueP50 = mQueueLatency.Percentile(0.5);
+		stats->mQueueP99 = mQueueLatency.Percentile(0.99);
+		stats->mUploadP50 = mUploadLatency.Percentile(0.5);
+		stats->mUploadP99 = mUploadLatency.Percentile(0.99);
+
+		std::lock_guard<ProfiledMutex> lock(mMutex);
+		stats->mPoolFrames = mNumBuffers;
+		stats->mFreeFrames = (int64_t)mFreeFrames.size();
+		stats->mQueuedFrames = (int64_t)mDisplayFrames.size();
 	}
 
 	// Create an instance of the VideoFrameManager class
@@ -294,7 +479,8 @@ namespace FPVR
 	}
 
 	// Constructor: Initialise all member variables to a known state
-	VideoFrameManager::VideoFrameManager(int poolSize)
+	VideoFrameManager::VideoFrameManager(int poolSize) :
+		mMutex("VideoFrameManager::mMutex")
 	{
 		mTexture = nullptr;
 
@@ -304,7 +490,21 @@ namespace FPVR
 
 		mPoolSize = poolSize;
 		mNumBuffers = 0;
-		mDisplayFrame = nullptr;
+
+		mFramesQueued = 0;
+		mFramesDisplayed = 0;
+		mFramesDropped = 0;
+		mFramesRepeated = 0;
+		mBytesUploaded = 0;
+
+		mNextDueTime = INT64_MAX;
+		mNeedsRecycle = true;
+
+		mHudEnabled = false;
+		mHudAudioFill = -1;
+		mHudWindowStart = 0;
+		mHudWindowFrames = 0;
+		mHudFps = 0.0f;
 	}
 
 	// Destructor: Release all resources allocated
@@ -312,7 +512,7 @@ namespace FPVR
 	// is a possibility of another thread still using frames
 	VideoFrameManager::~VideoFrameManager()
 	{
-		VideoFrame* frame = GrabDisplayFrame();
+		mDisplayFrames.clear();
 
 		ClearFrameList(mFreeFrames);
 		ClearFrameList(mAllocatedFrames);
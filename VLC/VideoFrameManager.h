@@ -1,13 +1,34 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <mutex>
 
 #include "UnityPlugin.h"
 #include "VideoFrame.h"
+#include "LatencyHistogram.h"
+#include "ProfiledMutex.h"
 
 namespace FPVR
 {
+	// Frame manager statistics (times in microseconds)
+	typedef struct
+	{
+		int64_t mFramesQueued;		// Frames queued for display
+		int64_t mFramesDisplayed;	// Frames copied to the texture
+		int64_t mFramesDropped;		// Frames replaced by a newer frame before they were displayed
+		int64_t mFramesRepeated;	// Renders with no new frame due (the texture kept the previous frame)
+		int64_t mBytesUploaded;		// Pixel bytes copied to the texture
+		int64_t mPoolFrames;		// Frames owned by the manager
+		int64_t mFreeFrames;		// Frames ready to be written
+		int64_t mQueuedFrames;		// Frames waiting for their presentation time
+		int64_t mQueueP50;			// Time from being queued to being rendered
+		int64_t mQueueP99;
+		int64_t mUploadP50;			// Time taken to copy a frame to the texture
+		int64_t mUploadP99;
+	} VFMStats;
+
 	// ------------------------------------------------------------------------------------------------
 	// Video Frame Manager Class
 	//
@@ -23,9 +44,24 @@ namespace FPVR
 	//			requests a frame to display
 	//			Copies memory away
 	//			Finishes copy and releases memory
+	//
+	// Frames waiting to be displayed are queued with the time they are due (libvlc clock), the
+	// viewer shows the newest frame due at its presentation time so video can follow a clock
+	// other than the one libvlc displays frames by (eg. the audio actually heard).
 	class VideoFrameManager
 	{
+	public:
+		static const int MaxQueuedFrames = 8;		// Frames that can wait for their presentation time
+
 	protected:
+		// Frame waiting to be displayed
+		typedef struct
+		{
+			VideoFrame* mFrame;		// Frame (will be on mAllocatedFrames list)
+			int64_t mTime;			// Time frame is due to be displayed (libvlc clock, microseconds)
+			int64_t mQueuedAt;		// Time frame was queued (LatencyHistogram::Now)
+		} sQueuedFrame;
+
 		void* mTexture;				// Texture to be updated
 
 		int mWidth;					// Width of frame in pixels
@@ -35,14 +71,38 @@ namespace FPVR
 		int mPoolSize;				// Number of buffers manager aims to have in pool
 		int mNumBuffers;			// Total number of buffers owned by manager
 
-		std::mutex	mMutex;			// Mutex used to make frame list/reference access thread safe
+		ProfiledMutex mMutex;		// Mutex used to make frame list/reference access thread safe
 
 		std::list<VideoFrame*>	mFreeFrames;		// List of free video frames (all locked)
 		std::list<VideoFrame*>	mAllocatedFrames;	// List of allocated video frames (all locked)
-		VideoFrame*				mDisplayFrame;		// Frame to display next (will be on mAllocatedFrames list, will be unlocked before rendered)
+		std::list<sQueuedFrame>	mDisplayFrames;		// Frames to display in time order (will be on mAllocatedFrames list, will be unlocked before rendered)
 		std::list<VideoFrame*>	mPendingFrames;		// List of frames we want to lock before they go back on free list (all unlocked)
 		std::list<VideoFrame*>	mReleaseFrames;		// List of frames we want to release 
 
+		// Statistics
+		std::atomic<int64_t> mFramesQueued;
+		std::atomic<int64_t> mFramesDisplayed;
+		std::atomic<int64_t> mFramesDropped;
+		std::atomic<int64_t> mFramesRepeated;
+		std::atomic<int64_t> mBytesUploaded;
+		LatencyHistogram mQueueLatency;				// Queued to rendered
+		LatencyHistogram mUploadLatency;			// Copy to texture
+
+		// Render dirty state, read without the mutex by batched rendering
+		std::atomic<int64_t> mNextDueTime;			// Time the oldest display frame is due (INT64_MAX if none)
+		std::atomic<bool> mNeedsRecycle;			// Pending or release frames waiting, or the free list ran dry
+
+		// Performance HUD
+		static const int64_t HudFpsInterval = 1000000;	// Time frame rate is averaged over (microseconds)
+		std::atomic<bool> mHudEnabled;				// True if the HUD is drawn into frames
+		std::atomic<int> mHudAudioFill;				// Buffered audio shown on the HUD (milliseconds, -1 if none)
+		int64_t mHudWindowStart;					// Start of current frame rate interval (render thread)
+		int mHudWindowFrames;						// Frames displayed in current interval (render thread)
+		float mHudFps;								// Frame rate over the last interval (render thread)
+
+		// Draw the HUD into a frame about to be copied to the texture (render thread)
+		void DrawFrameHud(VideoFrame* frame, int64_t now, int64_t queuedAt);
+
 		void MoveListToRelease(std::list<VideoFrame*>& frameList);
 		void ClearFrameList(std::list<VideoFrame*>& frameList);
 		static bool ListContains(std::list<VideoFrame*>& frameList, VideoFrame* frame);
@@ -52,8 +112,9 @@ namespace FPVR
 		void MoveAllocatedToPending(VideoFrame* videoFrame);
 
 		VideoFrame* NewFrame();
-		VideoFrame* GrabDisplayFrame();
+		VideoFrame* GrabDisplayFrame(int64_t presentTime, int64_t* queuedAt);
 		void AllocFrame();
+		void UpdateNextDueTime();
 
 		// Free the video frame
 
@@ -82,15 +143,42 @@ namespace FPVR
 		// Get a free frame from the list (if none available stall until we get one)
 		VideoFrame* GetFrame();
 
-		// Set specified frame as next frame to display
-		void DisplayFrame(VideoFrame* videoFrame);
+		// Queue specified frame to be displayed at (libvlc clock) time
+		void DisplayFrame(VideoFrame* videoFrame, int64_t displayTime);
+
+		// Return a filled frame to the free list without displaying it
+		void DiscardFrame(VideoFrame* videoFrame);
+
+		// Drop all frames waiting to be displayed (eg. after a seek)
+		void FlushDisplayFrames();
 
 		// Attempt to map pending frames and put them on the free list.
 		void UpdateFrames();
 
-		// If there is a current display frame then copy it to target and release
-		// display frame.
-		void Render();
+		// If there is a display frame due at presentTime then copy the newest one to target
+		// and release it (earlier frames that were due are dropped).
+		void Render(int64_t presentTime = INT64_MAX);
+
+		// Render in phases so a batch of managers can be rendered with all the uploads back to
+		// back (render thread). NeedsRender is lock free and says whether either phase has any
+		// work at presentTime, RecycleFrames releases and recycles frames and tops up the pool,
+		// UploadFrame copies the frame due (if any) to the target. Render does all three.
+		bool NeedsRender(int64_t presentTime) const;
+		void RecycleFrames();
+		void UploadFrame(int64_t presentTime);
+
+		// Copy frame counters, pool depth and stage latencies (any thread)
+		void GetStats(VFMStats* stats);
+
+		// Copy just the frame and byte counters, lock free (any thread)
+		void GetCounters(VFMStats* stats);
+
+		// Draw frame rate, dropped frames, queue latency and buffer fill into the top left of
+		// each frame displayed (32 bit formats only)
+		void SetHudEnabled(bool enable) { mHudEnabled = enable; }
+
+		// Set buffered audio shown on the HUD (milliseconds, -1 to hide)
+		void SetHudAudioFill(int fill) { mHudAudioFill = fill; }
 
 	};
 }
\ No newline at end of file